@@ -0,0 +1,4013 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <limits>
+#include <map>
+#include <set>
+#include <sstream>
+#include <typeindex>
+#include <typeinfo>
+#include <unordered_map>
+#include <poll.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "ns3/core-module.h"
+#include "ns3/point-to-point-module.h"
+#include "ns3/network-module.h"
+#include "ns3/applications-module.h"
+#include "ns3/mobility-module.h"
+#include "ns3/csma-module.h"
+#include "ns3/internet-module.h"
+#include "ns3/traffic-control-module.h"
+#include "ns3/yans-wifi-helper.h"
+#include "ns3/wifi-net-device.h"
+#include "ns3/sta-wifi-mac.h"
+#include "ns3/propagation-module.h"
+#include "ns3/ssid.h"
+#include "ns3/flow-monitor-module.h"
+#ifdef NS3_MPI
+#include "ns3/mpi-interface.h"
+#endif
+
+// Network Topology
+//
+//   Wifi 10.1.3.0  n3(ISP)
+//                  |
+//  *  *  *  *  *   | (10.1.4.0)
+//  |  |  |  |  |   |                (10.1.1.0)
+// n4 n5 n6 n7 n8   n0(Router/Ap) -------------- n1
+//   (10.1.3.0)     |
+//                  | (10.1.2.0)
+//                  |
+//                  n2
+
+// The topology is built once and the traffic comes from a flow table.
+// Every row of the table is a MyApp TCP sender on one of the PCs or STAs
+// and a port of the MultiPortSink on the ISP node n3.  A row is written as
+//
+//   source:port[:rate[:start[:stop]]]
+//
+// where source is pc1 (n1), pc2 (n2) or staN (the N-th wifi station, n4
+// is sta0).  The rate defaults to --appRate, start to --flowStart (1s,
+// or 0 with --preAssociate) and stop to the end of the simulation; a
+// rate of "max" makes a saturated sender that keeps the TCP buffer full
+// instead of pacing (--saturate does that for every flow).  Rows are
+// given with --flows (comma separated) or one per line in --flowFile
+// (blanks instead of colons are accepted there, '#' starts a comment).
+// Without either, --scenario=1..4 selects
+// the flow table of the former wn_a2_p1..p4 programs, scenario 4 having
+// one flow per station for any --nWifi:
+//
+//   ./waf --run "wn_a2_scenario --scenario=2"
+//   ./waf --run "wn_a2_scenario --flows=pc1:8080:50Mbps,sta0:8081:20Mbps:2"
+//   ./waf --run "wn_a2_scenario --flowFile=flows.txt"
+//
+// With --homes=K the home above is built K times, each with a WiFi
+// channel, SSID and networks of its own (see HomeNetwork), and the
+// routers are uplinked to an aggregation router in front of the ISP
+// server instead of to the server itself:
+//
+//   home 0 n0 -------+
+//   home 1 n0 -------+-- aggregation router -------- ISP server
+//     ...            |       (10.0.0.0, --aggregationRate/Delay)
+//   home K-1 n0 -----+
+//
+// Every home runs the whole flow table; home k's flows use the table's
+// ports shifted by k times their span (8080.. in home 0, 8087.. in home
+// 1 for scenario 4 with 5 stations).
+// With --protocol=udp every sender is a UDP MyApp stamping a sequence
+// number and send time in its packets instead, which measures the
+// capacity of the links without TCP's dynamics.
+using namespace ns3;
+
+NS_LOG_COMPONENT_DEFINE ("WnA2Scenario");
+
+// Byte tag MyApp puts on the bytes of every TCP packet it sends: the
+// send time, the packet's number in the flow and its size.  Byte tags
+// follow the bytes through TCP's segmentation and reassembly, so the
+// sink can tell when the last byte of a packet has been delivered.
+class SendTimeTag : public Tag
+{
+public:
+  static TypeId GetTypeId (void);
+  virtual TypeId GetInstanceTypeId (void) const;
+  SendTimeTag ();
+  SendTimeTag (Time sent, uint32_t seq, uint32_t size);
+
+  virtual uint32_t GetSerializedSize (void) const;
+  virtual void Serialize (TagBuffer buffer) const;
+  virtual void Deserialize (TagBuffer buffer);
+  virtual void Print (std::ostream &os) const;
+
+  int64_t GetSendTime (void) const; //nanoseconds
+  uint32_t GetSeq (void) const;
+  uint32_t GetSize (void) const;
+
+private:
+  int64_t  m_sent;
+  uint32_t m_seq;
+  uint32_t m_size;
+};
+
+NS_OBJECT_ENSURE_REGISTERED (SendTimeTag);
+
+TypeId
+SendTimeTag::GetTypeId (void)
+{
+  static TypeId tid = TypeId ("ns3::SendTimeTag")
+    .SetParent<Tag> ()
+    .AddConstructor<SendTimeTag> ()
+  ;
+  return tid;
+}
+
+TypeId
+SendTimeTag::GetInstanceTypeId (void) const
+{
+  return GetTypeId ();
+}
+
+SendTimeTag::SendTimeTag ()
+  : m_sent (0),
+    m_seq (0),
+    m_size (0)
+{
+}
+
+SendTimeTag::SendTimeTag (Time sent, uint32_t seq, uint32_t size)
+  : m_sent (sent.GetNanoSeconds ()),
+    m_seq (seq),
+    m_size (size)
+{
+}
+
+uint32_t
+SendTimeTag::GetSerializedSize (void) const
+{
+  return 16;
+}
+
+void
+SendTimeTag::Serialize (TagBuffer buffer) const
+{
+  buffer.WriteU64 (m_sent);
+  buffer.WriteU32 (m_seq);
+  buffer.WriteU32 (m_size);
+}
+
+void
+SendTimeTag::Deserialize (TagBuffer buffer)
+{
+  m_sent = buffer.ReadU64 ();
+  m_seq = buffer.ReadU32 ();
+  m_size = buffer.ReadU32 ();
+}
+
+void
+SendTimeTag::Print (std::ostream &os) const
+{
+  os << "sent=" << m_sent << "ns seq=" << m_seq << " size=" << m_size;
+}
+
+int64_t
+SendTimeTag::GetSendTime (void) const
+{
+  return m_sent;
+}
+
+uint32_t
+SendTimeTag::GetSeq (void) const
+{
+  return m_seq;
+}
+
+uint32_t
+SendTimeTag::GetSize (void) const
+{
+  return m_size;
+}
+
+class MyApp : public Application //the class which sends TCP or UDP packets to the MultiPortSink
+{
+public:
+  MyApp ();
+  virtual ~MyApp ();
+
+  void Setup (Ptr<Socket> socket, Address address, uint32_t packetSize, uint32_t nPackets, DataRate dataRate);
+  void SetReusePayload (bool reuse);
+  void SetSaturate (bool saturate);
+  void SetPacing (uint32_t burst, Time interval);
+  void SetSequenceStamps (bool stamp);
+  void SetSendTimeTags (bool tag);
+  void SetAssociationMac (Ptr<StaWifiMac> mac);
+
+private:
+  virtual void StartApplication (void);
+  virtual void StopApplication (void);
+
+  void StartSending (void);
+  void Associated (Mac48Address bssid);
+
+  void ScheduleTx (void);
+  void SendPacket (void);
+  void SendBurst (void);
+  void FillTxBuffer (Ptr<Socket> socket, uint32_t available);
+  Ptr<Packet> NewPacket (void);
+
+  Ptr<Socket>     m_socket;
+  Address         m_peer;
+  uint32_t        m_packetSize;
+  uint32_t        m_nPackets;
+  DataRate        m_dataRate;
+  EventId         m_sendEvent;
+  bool            m_running;
+  uint32_t        m_packetsSent;
+  Ptr<Packet>     m_payload; //copied for every send when reusing payloads
+  bool            m_stamp;   //SeqTsHeader at the front of every packet
+  bool            m_tag;     //SendTimeTag on the bytes of every packet
+  bool            m_saturate; //send whenever the socket has room, no timer
+  uint32_t        m_burst;    //packets per pacing wakeup, 0 for a timer per packet
+  Time            m_interval; //between pacing wakeups, zero to derive it from m_burst
+  uint64_t        m_wakeupNs; //m_interval, or the time m_burst packets take at m_dataRate
+  uint64_t        m_tokens;   //pacing credit in bit-nanoseconds (bits times 10^9)
+  Ptr<StaWifiMac> m_associationMac; //not sending before it is associated
+  bool            m_waiting;  //for m_associationMac
+};
+
+MyApp::MyApp ()
+  : m_socket (0),
+    m_peer (),
+    m_packetSize (0),
+    m_nPackets (0),
+    m_dataRate (0),
+    m_sendEvent (),
+    m_running (false),
+    m_packetsSent (0),
+    m_stamp (false),
+    m_tag (false),
+    m_saturate (false),
+    m_burst (0),
+    m_interval (),
+    m_wakeupNs (0),
+    m_tokens (0),
+    m_waiting (false)
+{
+}
+
+MyApp::~MyApp ()
+{
+  m_socket = 0;
+  m_payload = 0;
+  m_associationMac = 0;
+}
+
+void
+MyApp::Setup (Ptr<Socket> socket, Address address, uint32_t packetSize, uint32_t nPackets, DataRate dataRate)
+{
+  m_socket = socket;
+  m_peer = address;
+  m_packetSize = packetSize;
+  m_nPackets = nPackets;
+  m_dataRate = dataRate;
+}
+
+// With payload reuse every send is a copy-on-write Copy () of one
+// zero-filled packet built here, which shares its buffer instead of
+// setting up a fresh Packet/Buffer per segment.  The copies keep the
+// template's uid, as TCP fragments of one application packet already do.
+// The sent packets themselves cannot be recycled: TCP's tx buffer keeps
+// and trims them until they are acknowledged.
+void
+MyApp::SetReusePayload (bool reuse)
+{
+  m_payload = reuse ? Create<Packet> (m_packetSize - (m_stamp ? SeqTsHeader ().GetSerializedSize () : 0)) : Ptr<Packet> ();
+}
+
+// Stamped packets start with a 12 byte SeqTsHeader, the packet's number
+// in the flow and its send time, in place of as many payload bytes; the
+// UDP sink derives loss, reordering and one-way delay from it.  Set it
+// before SetReusePayload.
+void
+MyApp::SetSequenceStamps (bool stamp)
+{
+  m_stamp = stamp;
+}
+
+void
+MyApp::SetSendTimeTags (bool tag)
+{
+  m_tag = tag;
+}
+
+// In saturated mode the data rate is ignored: the app keeps the socket's
+// tx buffer full and is woken by the socket's send callback when acks
+// free space, instead of firing a timer per packet whose send the full
+// buffer would mostly refuse.
+void
+MyApp::SetSaturate (bool saturate)
+{
+  m_saturate = saturate;
+}
+
+// Paced mode sends up to a burst of packets per timer event instead of
+// one: a token bucket is credited with the data rate times the time
+// since the last wakeup, and every packet sent takes its size from it.
+// Credit is kept in bits times 10^9 and time in integer nanoseconds, so
+// the left-over credit of one wakeup carries into the next exactly and
+// the average rate is the data rate, while the app schedules a factor
+// of burst fewer events.  Given an interval instead of a burst size, the
+// app wakes up that often and sends whatever has been credited.
+void
+MyApp::SetPacing (uint32_t burst, Time interval)
+{
+  m_burst = burst;
+  m_interval = interval;
+}
+
+// With the STAs probing actively instead of waiting for a beacon, they
+// associate within milliseconds of the start, but a flow starting at 0
+// must still not send before its station has associated: its start is
+// then deferred to the MAC's Assoc trace.
+void
+MyApp::SetAssociationMac (Ptr<StaWifiMac> mac)
+{
+  m_associationMac = mac;
+}
+
+void
+MyApp::StartApplication (void)
+{
+  if (m_associationMac && !m_associationMac->IsAssociated ())
+    {
+      m_waiting = true;
+      m_associationMac->TraceConnectWithoutContext ("Assoc", MakeCallback (&MyApp::Associated, this));
+      return;
+    }
+  StartSending ();
+}
+
+void
+MyApp::Associated (Mac48Address bssid)
+{
+  if (m_waiting)
+    {
+      m_waiting = false;
+      StartSending ();
+    }
+}
+
+void
+MyApp::StartSending (void)
+{
+  m_running = true;
+  m_packetsSent = 0;
+  m_socket->Bind ();
+  m_socket->Connect (m_peer);
+  if (m_saturate)
+    {
+      m_socket->SetSendCallback (MakeCallback (&MyApp::FillTxBuffer, this));
+      FillTxBuffer (m_socket, m_socket->GetTxAvailable ());
+    }
+  else if (m_burst > 0 || m_interval.IsStrictlyPositive ())
+    {
+      uint64_t packetCost = m_packetSize * 8 * UINT64_C (1000000000);
+      uint64_t bitRate = m_dataRate.GetBitRate ();
+      m_wakeupNs = m_interval.IsStrictlyPositive () ? m_interval.GetNanoSeconds ()
+        : (m_burst * packetCost + bitRate - 1) / bitRate;
+      m_tokens = packetCost; //the first packet goes at the start, as unpaced
+      SendBurst ();
+    }
+  else
+    {
+      SendPacket ();
+    }
+}
+
+void
+MyApp::StopApplication (void)
+{
+  m_running = false;
+  m_waiting = false;
+
+  if (m_sendEvent.IsRunning ())
+    {
+      Simulator::Cancel (m_sendEvent);
+    }
+
+  if (m_socket)
+    {
+      m_socket->Close ();
+    }
+}
+
+Ptr<Packet>
+MyApp::NewPacket (void)
+{
+  if (!m_stamp)
+    {
+      Ptr<Packet> packet = m_payload ? m_payload->Copy () : Create<Packet> (m_packetSize);
+      if (m_tag)
+        {
+          packet->AddByteTag (SendTimeTag (Simulator::Now (), m_packetsSent, m_packetSize));
+        }
+      return packet;
+    }
+  SeqTsHeader stamp;
+  stamp.SetSeq (m_packetsSent);
+  Ptr<Packet> packet = m_payload ? m_payload->Copy () : Create<Packet> (m_packetSize - stamp.GetSerializedSize ());
+  packet->AddHeader (stamp);
+  return packet;
+}
+
+void
+MyApp::SendPacket (void)
+{
+  m_socket->Send (NewPacket ());
+
+  if (++m_packetsSent < m_nPackets)
+    {
+      ScheduleTx ();
+    }
+}
+
+void
+MyApp::ScheduleTx (void)
+{
+  if (m_running)
+    {
+      Time tNext (Seconds (m_packetSize * 8 / static_cast<double> (m_dataRate.GetBitRate ())));
+      m_sendEvent = Simulator::Schedule (tNext, &MyApp::SendPacket, this);
+    }
+}
+
+void
+MyApp::SendBurst (void)
+{
+  uint64_t packetCost = m_packetSize * 8 * UINT64_C (1000000000);
+  for (; m_tokens >= packetCost && m_packetsSent < m_nPackets; m_tokens -= packetCost)
+    {
+      m_socket->Send (NewPacket ());
+      ++m_packetsSent;
+    }
+  if (m_running && m_packetsSent < m_nPackets)
+    {
+      m_tokens += m_dataRate.GetBitRate () * m_wakeupNs;
+      m_sendEvent = Simulator::Schedule (NanoSeconds (m_wakeupNs), &MyApp::SendBurst, this);
+    }
+}
+
+void
+MyApp::FillTxBuffer (Ptr<Socket> socket, uint32_t available)
+{
+  while (m_running && m_packetsSent < m_nPackets && socket->GetTxAvailable () >= m_packetSize)
+    {
+      if (socket->Send (NewPacket ()) < 0)
+        {
+          break;
+        }
+      ++m_packetsSent;
+    }
+}
+
+// Fixed size histogram of nanosecond values with logarithmic buckets:
+// values below 16 have a bucket each, above that every power of two is
+// split into 16 buckets, so a bucket is at most 1/16 of its values wide
+// whatever the magnitude and the whole uint64_t range takes 976 counts.
+// Histograms with the same layout add up bucket by bucket, so those of
+// several replications merge into one without losing precision; Write
+// and Read carry one as text, the non-empty buckets only.
+class LatencyHistogram
+{
+public:
+  LatencyHistogram ();
+
+  void Add (uint64_t ns);
+  void Merge (const LatencyHistogram &other);
+  void Write (std::ostream &out) const;
+  void Read (std::istream &in);
+  uint64_t GetCount (void) const;
+  uint64_t GetMax (void) const;
+  double GetMean (void) const;
+  uint64_t GetPercentile (double percent) const; //upper edge of the bucket holding it
+
+private:
+  static const uint32_t SUB_BITS = 4;
+
+  static uint32_t Bucket (uint64_t ns);
+  static uint64_t UpperEdge (uint32_t bucket);
+
+  std::vector<uint64_t> m_counts;
+  uint64_t m_count;
+  uint64_t m_max;
+  uint64_t m_sum;
+};
+
+LatencyHistogram::LatencyHistogram ()
+  : m_counts ((64 - SUB_BITS + 1) << SUB_BITS, 0),
+    m_count (0),
+    m_max (0),
+    m_sum (0)
+{
+}
+
+uint32_t
+LatencyHistogram::Bucket (uint64_t ns)
+{
+  if (ns < (1u << SUB_BITS))
+    {
+      return ns;
+    }
+  uint32_t shift = 63 - __builtin_clzll (ns) - SUB_BITS; //bits below the leading 1 and the sub-bucket bits
+  return ((shift + 1) << SUB_BITS) | ((ns >> shift) & ((1u << SUB_BITS) - 1));
+}
+
+uint64_t
+LatencyHistogram::UpperEdge (uint32_t bucket)
+{
+  if (bucket < (1u << SUB_BITS))
+    {
+      return bucket;
+    }
+  uint32_t shift = (bucket >> SUB_BITS) - 1;
+  uint64_t lower = (uint64_t) ((1u << SUB_BITS) | (bucket & ((1u << SUB_BITS) - 1))) << shift;
+  return lower + ((UINT64_C (1) << shift) - 1);
+}
+
+void
+LatencyHistogram::Add (uint64_t ns)
+{
+  ++m_counts[Bucket (ns)];
+  ++m_count;
+  m_max = std::max (m_max, ns);
+  m_sum += ns;
+}
+
+void
+LatencyHistogram::Merge (const LatencyHistogram &other)
+{
+  for (uint32_t bucket = 0; bucket < m_counts.size (); ++bucket)
+    {
+      m_counts[bucket] += other.m_counts[bucket];
+    }
+  m_count += other.m_count;
+  m_max = std::max (m_max, other.m_max);
+  m_sum += other.m_sum;
+}
+
+// "<count> <sum> <max> <buckets> <bucket> <count> ..."
+void
+LatencyHistogram::Write (std::ostream &out) const
+{
+  uint32_t used = m_counts.size () - std::count (m_counts.begin (), m_counts.end (), 0);
+  out << m_count << " " << m_sum << " " << m_max << " " << used;
+  for (uint32_t bucket = 0; bucket < m_counts.size (); ++bucket)
+    {
+      if (m_counts[bucket] > 0)
+        {
+          out << " " << bucket << " " << m_counts[bucket];
+        }
+    }
+}
+
+void
+LatencyHistogram::Read (std::istream &in)
+{
+  uint32_t used = 0;
+  in >> m_count >> m_sum >> m_max >> used;
+  for (uint32_t i = 0; i < used; ++i)
+    {
+      uint32_t bucket = 0;
+      uint64_t count = 0;
+      if (in >> bucket >> count && bucket < m_counts.size ())
+        {
+          m_counts[bucket] = count;
+        }
+    }
+}
+
+uint64_t
+LatencyHistogram::GetCount (void) const
+{
+  return m_count;
+}
+
+uint64_t
+LatencyHistogram::GetMax (void) const
+{
+  return m_max;
+}
+
+double
+LatencyHistogram::GetMean (void) const
+{
+  return m_count > 0 ? (double) m_sum / m_count : 0;
+}
+
+uint64_t
+LatencyHistogram::GetPercentile (double percent) const
+{
+  uint64_t rank = (uint64_t) std::ceil (percent / 100 * m_count);
+  uint64_t seen = 0;
+  for (uint32_t bucket = 0; bucket < m_counts.size (); ++bucket)
+    {
+      seen += m_counts[bucket];
+      if (seen >= rank && seen > 0)
+        {
+          return std::min (UpperEdge (bucket), m_max);
+        }
+    }
+  return 0;
+}
+
+// Sink for a whole range of ports in one application, instead of a
+// PacketSink per port.  Every port listened on is a flow whose id is the
+// port minus the first port of the range; the bytes received per flow
+// are kept in one flat array that the measurement code reads directly,
+// without an Rx trace per sink.
+// In UDP mode the datagrams carry MyApp's sequence stamps, and every
+// flow keeps its loss, reordering and one-way delay in constant memory:
+// a packet numbered below the highest one seen so far is counted as
+// reordered, and the packets never received are the highest number
+// seen plus one, minus the packets received.  A traffic epoch starts new
+// senders numbering from 0 again, so NextEpoch moves the count of every
+// flow's earlier senders aside before they do.
+// The one-way delay of every flow goes into a LatencyHistogram: from the
+// stamps of UDP packets, and with latency measurement on, from MyApp's
+// SendTimeTag once the last byte of a TCP packet has been received.
+class MultiPortSink : public Application
+{
+public:
+  MultiPortSink ();
+  virtual ~MultiPortSink ();
+
+  struct DatagramStats //of one UDP flow
+  {
+    DatagramStats ();
+
+    uint64_t received;
+    uint64_t reordered;
+    int64_t highestSeq; //of the current epoch's sender, -1 before its first packet
+    uint64_t earlierSent; //highest numbers plus one of the earlier epochs' senders
+  };
+
+  void Setup (uint16_t firstPort, uint32_t nPorts);
+  void SetUdp (bool udp);
+  void SetLatency (bool latency);
+  void AddPort (uint16_t port);
+  void NextEpoch (void);
+  uint16_t GetFirstPort (void) const;
+  const std::vector<uint64_t> &GetRxBytes (void) const; //indexed by flow id
+  const std::vector<DatagramStats> &GetDatagramStats (void) const; //indexed by flow id, empty for TCP
+  const std::vector<LatencyHistogram> &GetLatency (void) const; //indexed by flow id, empty for TCP without latency
+
+private:
+  virtual void StartApplication (void);
+  virtual void StopApplication (void);
+
+  static void Accept (MultiPortSink *sink, uint32_t flow, Ptr<Socket> socket, const Address &from);
+  static void Receive (MultiPortSink *sink, uint32_t flow, Ptr<Socket> socket);
+  static void ReceiveDatagram (MultiPortSink *sink, uint32_t flow, Ptr<Socket> socket);
+  void RecordSendTimes (uint32_t flow, Ptr<const Packet> packet);
+
+  uint16_t                 m_firstPort;
+  bool                     m_udp;
+  std::vector<uint16_t>    m_ports;   //to listen on
+  std::vector<Ptr<Socket> > m_sockets; //listening and accepted
+  std::vector<uint64_t>    m_rxBytes;
+  std::vector<DatagramStats> m_datagrams;
+  bool                     m_measureLatency;
+  std::vector<LatencyHistogram> m_latency;
+  std::vector<uint32_t>    m_taggedSeq;   //TCP packet of every flow being received
+  std::vector<uint32_t>    m_taggedBytes; //of it received so far
+};
+
+MultiPortSink::DatagramStats::DatagramStats ()
+  : received (0),
+    reordered (0),
+    highestSeq (-1),
+    earlierSent (0)
+{
+}
+
+MultiPortSink::MultiPortSink ()
+  : m_firstPort (0),
+    m_udp (false),
+    m_measureLatency (false)
+{
+}
+
+MultiPortSink::~MultiPortSink ()
+{
+  m_sockets.clear ();
+}
+
+void
+MultiPortSink::Setup (uint16_t firstPort, uint32_t nPorts)
+{
+  m_firstPort = firstPort;
+  m_rxBytes.assign (nPorts, 0);
+  m_datagrams.assign (m_udp ? nPorts : 0, DatagramStats ());
+  m_latency.assign (m_udp || m_measureLatency ? nPorts : 0, LatencyHistogram ());
+  m_taggedSeq.assign (m_udp || !m_measureLatency ? 0 : nPorts, 0);
+  m_taggedBytes.assign (m_taggedSeq.size (), 0);
+}
+
+// set before Setup
+void
+MultiPortSink::SetUdp (bool udp)
+{
+  m_udp = udp;
+}
+
+// set before Setup; the senders of TCP flows must tag their packets
+void
+MultiPortSink::SetLatency (bool latency)
+{
+  m_measureLatency = latency;
+}
+
+// ports of the range nobody sends to need no listening socket
+void
+MultiPortSink::AddPort (uint16_t port)
+{
+  m_ports.push_back (port);
+}
+
+void
+MultiPortSink::NextEpoch (void)
+{
+  for (std::vector<DatagramStats>::iterator stats = m_datagrams.begin (); stats != m_datagrams.end (); ++stats)
+    {
+      stats->earlierSent += stats->highestSeq + 1;
+      stats->highestSeq = -1;
+    }
+  std::fill (m_taggedBytes.begin (), m_taggedBytes.end (), 0);
+}
+
+uint16_t
+MultiPortSink::GetFirstPort (void) const
+{
+  return m_firstPort;
+}
+
+const std::vector<uint64_t> &
+MultiPortSink::GetRxBytes (void) const
+{
+  return m_rxBytes;
+}
+
+const std::vector<MultiPortSink::DatagramStats> &
+MultiPortSink::GetDatagramStats (void) const
+{
+  return m_datagrams;
+}
+
+const std::vector<LatencyHistogram> &
+MultiPortSink::GetLatency (void) const
+{
+  return m_latency;
+}
+
+void
+MultiPortSink::StartApplication (void)
+{
+  for (std::vector<uint16_t>::const_iterator port = m_ports.begin (); port != m_ports.end (); ++port)
+    {
+      Ptr<Socket> socket = Socket::CreateSocket (GetNode (), m_udp ? UdpSocketFactory::GetTypeId ()
+                                                 : TcpSocketFactory::GetTypeId ());
+      if (socket->Bind (InetSocketAddress (Ipv4Address::GetAny (), *port)) == -1)
+        {
+          NS_FATAL_ERROR ("MultiPortSink cannot bind port " << *port);
+        }
+      m_sockets.push_back (socket);
+      if (m_udp)
+        {
+          socket->SetRecvCallback (MakeBoundCallback (&MultiPortSink::ReceiveDatagram, this,
+                                                      (uint32_t) (*port - m_firstPort)));
+          continue;
+        }
+      socket->Listen ();
+      socket->SetAcceptCallback (MakeNullCallback<bool, Ptr<Socket>, const Address &> (),
+                                 MakeBoundCallback (&MultiPortSink::Accept, this, (uint32_t) (*port - m_firstPort)));
+    }
+}
+
+void
+MultiPortSink::StopApplication (void)
+{
+  for (std::vector<Ptr<Socket> >::iterator socket = m_sockets.begin (); socket != m_sockets.end (); ++socket)
+    {
+      (*socket)->Close ();
+      (*socket)->SetRecvCallback (MakeNullCallback<void, Ptr<Socket> > ());
+    }
+  m_sockets.clear ();
+}
+
+// a connection accepted on a listening socket belongs to its port's flow
+void
+MultiPortSink::Accept (MultiPortSink *sink, uint32_t flow, Ptr<Socket> socket, const Address &from)
+{
+  socket->SetRecvCallback (MakeBoundCallback (&MultiPortSink::Receive, sink, flow));
+  sink->m_sockets.push_back (socket);
+}
+
+void
+MultiPortSink::Receive (MultiPortSink *sink, uint32_t flow, Ptr<Socket> socket)
+{
+  Ptr<Packet> packet;
+  while ((packet = socket->Recv ()) && packet->GetSize () > 0)
+    {
+      sink->m_rxBytes[flow] += packet->GetSize ();
+      if (!sink->m_taggedSeq.empty ())
+        {
+          sink->RecordSendTimes (flow, packet);
+        }
+    }
+}
+
+// TCP delivers a flow's bytes in order, so the tagged ranges of one
+// packet arrive one after another and a running byte count per flow
+// finds the packet's last byte
+void
+MultiPortSink::RecordSendTimes (uint32_t flow, Ptr<const Packet> packet)
+{
+  ByteTagIterator tags = packet->GetByteTagIterator ();
+  while (tags.HasNext ())
+    {
+      ByteTagIterator::Item item = tags.Next ();
+      if (item.GetTypeId () != SendTimeTag::GetTypeId ())
+        {
+          continue;
+        }
+      SendTimeTag tag;
+      item.GetTag (tag);
+      if (tag.GetSeq () != m_taggedSeq[flow])
+        {
+          m_taggedSeq[flow] = tag.GetSeq ();
+          m_taggedBytes[flow] = 0;
+        }
+      m_taggedBytes[flow] += item.GetEnd () - item.GetStart ();
+      if (m_taggedBytes[flow] == tag.GetSize ())
+        {
+          m_latency[flow].Add (Simulator::Now ().GetNanoSeconds () - tag.GetSendTime ());
+        }
+    }
+}
+
+void
+MultiPortSink::ReceiveDatagram (MultiPortSink *sink, uint32_t flow, Ptr<Socket> socket)
+{
+  DatagramStats &stats = sink->m_datagrams[flow];
+  Ptr<Packet> packet;
+  while ((packet = socket->Recv ()))
+    {
+      sink->m_rxBytes[flow] += packet->GetSize ();
+      SeqTsHeader stamp;
+      packet->RemoveHeader (stamp);
+      ++stats.received;
+      if ((int64_t) stamp.GetSeq () < stats.highestSeq)
+        {
+          ++stats.reordered;
+        }
+      stats.highestSeq = std::max (stats.highestSeq, (int64_t) stamp.GetSeq ());
+      sink->m_latency[flow].Add ((Simulator::Now () - stamp.GetTs ()).GetNanoSeconds ());
+    }
+}
+
+// Per-port goodput accumulator reading the MultiPortSink counters.  Every
+// interval it appends one "time_s,port,bytes,goodput_mbps" row per port
+// to a CSV file while the simulation runs, so throughput is known without
+// writing and dissecting pcaps.
+class ThroughputMonitor
+{
+public:
+  ThroughputMonitor (std::string fileName, Time interval, Ptr<MultiPortSink> sink);
+
+  void AddPort (uint16_t port);
+  uint32_t GetNPorts (void) const;
+  void Start (Time stop);
+  void Finish (const std::map<uint16_t, double> &activeSeconds);
+
+private:
+  void WriteWindow (void);
+
+  std::ofstream         m_out;
+  Time                  m_interval;
+  Time                  m_stop;
+  Time                  m_windowStart;
+  Ptr<MultiPortSink>    m_sink;
+  std::vector<uint16_t> m_ports;
+  std::vector<uint64_t> m_windowStartBytes; //counter at m_windowStart, indexed like m_ports
+};
+
+ThroughputMonitor::ThroughputMonitor (std::string fileName, Time interval, Ptr<MultiPortSink> sink)
+  : m_out (fileName.c_str ()),
+    m_interval (interval),
+    m_sink (sink)
+{
+  m_out << "time_s,port,bytes,goodput_mbps\n";
+}
+
+void
+ThroughputMonitor::AddPort (uint16_t port)
+{
+  m_ports.push_back (port);
+  m_windowStartBytes.push_back (0);
+}
+
+uint32_t
+ThroughputMonitor::GetNPorts (void) const
+{
+  return m_ports.size ();
+}
+
+void
+ThroughputMonitor::Start (Time stop)
+{
+  m_stop = stop;
+  m_windowStart = Seconds (0);
+  Simulator::Schedule (m_interval, &ThroughputMonitor::WriteWindow, this);
+}
+
+void
+ThroughputMonitor::WriteWindow (void)
+{
+  Time now = Simulator::Now ();
+  double seconds = (now - m_windowStart).GetSeconds ();
+  const std::vector<uint64_t> &rxBytes = m_sink->GetRxBytes ();
+  for (uint32_t i = 0; i < m_ports.size (); ++i)
+    {
+      uint64_t total = rxBytes[m_ports[i] - m_sink->GetFirstPort ()];
+      uint64_t bytes = total - m_windowStartBytes[i];
+      m_out << now.GetSeconds () << "," << m_ports[i] << "," << bytes << ","
+            << (seconds > 0 ? bytes * 8 / seconds / 1e6 : 0) << "\n";
+      m_windowStartBytes[i] = total;
+    }
+  m_windowStart = now;
+  if (now + m_interval <= m_stop)
+    {
+      Simulator::Schedule (m_interval, &ThroughputMonitor::WriteWindow, this);
+    }
+}
+
+// writes the last partial window and prints the goodput of every port
+// over the time its flows were sending
+void
+ThroughputMonitor::Finish (const std::map<uint16_t, double> &activeSeconds)
+{
+  if (Simulator::Now () > m_windowStart)
+    {
+      WriteWindow ();
+    }
+  m_out.flush ();
+  for (uint32_t i = 0; i < m_ports.size (); ++i)
+    {
+      double seconds = activeSeconds.find (m_ports[i])->second;
+      std::cout << "port " << m_ports[i] << ": " << m_windowStartBytes[i] << " bytes, "
+                << (seconds > 0 ? m_windowStartBytes[i] * 8 / seconds / 1e6 : 0) << " Mbps" << std::endl;
+    }
+}
+
+// Samples the queue discs of the routers' uplinks.  Every interval it
+// appends one "time_s,home,packets,bytes,sojourn_mean_ms,sojourn_max_ms,
+// dropped" row per queue disc: the backlog at that instant, the sojourn
+// times of the packets dequeued during the interval from the SojournTime
+// trace, and the packets dropped so far.
+class QueueMonitor
+{
+public:
+  QueueMonitor (std::string fileName, Time interval);
+
+  void Add (Ptr<QueueDisc> queue, uint32_t home);
+  void Start (Time stop);
+  void Finish (void);
+
+private:
+  static void Sojourn (QueueMonitor *monitor, uint32_t index, Time sojourn);
+  void WriteSample (void);
+
+  std::ofstream                m_out;
+  Time                         m_interval;
+  Time                         m_stop;
+  std::vector<Ptr<QueueDisc> > m_queues;
+  std::vector<uint32_t>        m_homes;     //indexed like m_queues
+  std::vector<uint64_t>        m_windowCount;
+  std::vector<int64_t>         m_windowSum; //sojourn nanoseconds
+  std::vector<int64_t>         m_windowMax;
+  std::vector<uint64_t>        m_count;     //over the whole run
+  std::vector<int64_t>         m_sum;
+};
+
+QueueMonitor::QueueMonitor (std::string fileName, Time interval)
+  : m_out (fileName.c_str ()),
+    m_interval (interval)
+{
+  m_out << "time_s,home,packets,bytes,sojourn_mean_ms,sojourn_max_ms,dropped\n";
+}
+
+void
+QueueMonitor::Add (Ptr<QueueDisc> queue, uint32_t home)
+{
+  queue->TraceConnectWithoutContext ("SojournTime", MakeBoundCallback (&QueueMonitor::Sojourn, this,
+                                                                       (uint32_t) m_queues.size ()));
+  m_queues.push_back (queue);
+  m_homes.push_back (home);
+  m_windowCount.push_back (0);
+  m_windowSum.push_back (0);
+  m_windowMax.push_back (0);
+  m_count.push_back (0);
+  m_sum.push_back (0);
+}
+
+void
+QueueMonitor::Start (Time stop)
+{
+  m_stop = stop;
+  Simulator::Schedule (m_interval, &QueueMonitor::WriteSample, this);
+}
+
+void
+QueueMonitor::Sojourn (QueueMonitor *monitor, uint32_t index, Time sojourn)
+{
+  int64_t ns = sojourn.GetNanoSeconds ();
+  ++monitor->m_windowCount[index];
+  monitor->m_windowSum[index] += ns;
+  monitor->m_windowMax[index] = std::max (monitor->m_windowMax[index], ns);
+}
+
+void
+QueueMonitor::WriteSample (void)
+{
+  for (uint32_t i = 0; i < m_queues.size (); ++i)
+    {
+      m_out << Simulator::Now ().GetSeconds () << "," << m_homes[i] << "," << m_queues[i]->GetNPackets () << ","
+            << m_queues[i]->GetNBytes () << ","
+            << (m_windowCount[i] > 0 ? m_windowSum[i] / 1e6 / m_windowCount[i] : 0) << ","
+            << m_windowMax[i] / 1e6 << "," << m_queues[i]->GetStats ().nTotalDroppedPackets << "\n";
+      m_count[i] += m_windowCount[i];
+      m_sum[i] += m_windowSum[i];
+      m_windowCount[i] = 0;
+      m_windowSum[i] = 0;
+      m_windowMax[i] = 0;
+    }
+  if (Simulator::Now () + m_interval <= m_stop)
+    {
+      Simulator::Schedule (m_interval, &QueueMonitor::WriteSample, this);
+    }
+}
+
+// prints the mean sojourn time and the drops of every queue disc over
+// the whole run
+void
+QueueMonitor::Finish (void)
+{
+  m_out.flush ();
+  for (uint32_t i = 0; i < m_queues.size (); ++i)
+    {
+      uint64_t count = m_count[i] + m_windowCount[i];
+      const QueueDisc::Stats &stats = m_queues[i]->GetStats ();
+      std::cout << "home " << m_homes[i] << " uplink queue: mean sojourn "
+                << (count > 0 ? (m_sum[i] + m_windowSum[i]) / 1e6 / count : 0) << " ms, "
+                << stats.nTotalDroppedPackets << " of " << stats.nTotalReceivedPackets
+                << " packets dropped" << std::endl;
+    }
+}
+
+// Binary output file assembled in a large in-memory block and written
+// in one go whenever the block fills, instead of a stream write per
+// record.
+class BlockWriter
+{
+public:
+  BlockWriter (std::string fileName, uint32_t blockSize);
+  ~BlockWriter ();
+
+  void Append (const void *data, uint32_t size);
+  uint8_t *Reserve (uint32_t size); //room for size bytes at the end of the block
+
+private:
+  void Flush (void);
+
+  std::ofstream        m_out;
+  std::vector<uint8_t> m_block;
+  uint32_t             m_used;
+};
+
+BlockWriter::BlockWriter (std::string fileName, uint32_t blockSize)
+  : m_out (fileName.c_str (), std::ios::binary),
+    m_block (blockSize),
+    m_used (0)
+{
+}
+
+BlockWriter::~BlockWriter ()
+{
+  Flush ();
+}
+
+uint8_t *
+BlockWriter::Reserve (uint32_t size)
+{
+  if (m_used + size > m_block.size ())
+    {
+      Flush ();
+    }
+  uint8_t *room = &m_block[m_used];
+  m_used += size;
+  return room;
+}
+
+void
+BlockWriter::Append (const void *data, uint32_t size)
+{
+  std::copy (static_cast<const uint8_t *> (data), static_cast<const uint8_t *> (data) + size, Reserve (size));
+}
+
+void
+BlockWriter::Flush (void)
+{
+  m_out.write (reinterpret_cast<const char *> (&m_block[0]), m_used);
+  m_used = 0;
+}
+
+// Classic pcap file keeping at most snapLen bytes of each frame (0 keeps
+// whole frames).  Fed by a point-to-point device's PromiscSniffer
+// (DLT_PPP) or a wifi PHY's PhyTxBegin/PhyRxEnd (DLT_IEEE802_11, no
+// radiotap header).
+class PcapCapture
+{
+public:
+  PcapCapture (std::string fileName, uint32_t dataLinkType, uint32_t snapLen, uint32_t blockSize);
+
+  void Write (Ptr<const Packet> packet);
+
+  static void Sniff (PcapCapture *capture, Ptr<const Packet> packet);
+  static void SniffTx (PcapCapture *capture, Ptr<const Packet> packet, double txPowerW);
+
+private:
+  uint32_t    m_snapLen;
+  BlockWriter m_out;
+};
+
+PcapCapture::PcapCapture (std::string fileName, uint32_t dataLinkType, uint32_t snapLen, uint32_t blockSize)
+  : m_snapLen (snapLen > 0 ? std::min<uint32_t> (snapLen, 65535) : 65535),
+    m_out (fileName, std::max<uint32_t> (blockSize, 65535 + 16)) //room for any record
+{
+  uint32_t magic = 0xa1b2c3d4;
+  uint16_t version[2] = { 2, 4 };
+  uint32_t fields[4] = { 0, 0, m_snapLen, dataLinkType }; //thiszone, sigfigs, snaplen, network
+  m_out.Append (&magic, sizeof (magic));
+  m_out.Append (version, sizeof (version));
+  m_out.Append (fields, sizeof (fields));
+}
+
+void
+PcapCapture::Write (Ptr<const Packet> packet)
+{
+  int64_t us = Simulator::Now ().GetMicroSeconds ();
+  uint32_t length = packet->GetSize ();
+  uint32_t captured = std::min (length, m_snapLen);
+  uint32_t record[4] = { static_cast<uint32_t> (us / 1000000), static_cast<uint32_t> (us % 1000000), captured, length };
+  m_out.Append (record, sizeof (record));
+  packet->CopyData (m_out.Reserve (captured), captured);
+}
+
+void
+PcapCapture::Sniff (PcapCapture *capture, Ptr<const Packet> packet)
+{
+  capture->Write (packet);
+}
+
+void
+PcapCapture::SniffTx (PcapCapture *capture, Ptr<const Packet> packet, double txPowerW)
+{
+  capture->Write (packet);
+}
+
+// Time series of the TCP state of every MyApp socket in one binary file:
+// an 8 byte "WNTCP" header (5 characters, then 0, version 2, 0) and
+// 20 byte host-order records
+//
+//   int64 time_ns, uint32 flow, uint8 kind, uint8 0, uint16 0, uint32 value
+//
+// where kind is 0 cwnd, 1 ssthresh (bytes), 2 RTT (microseconds) or 3
+// bytes in flight.  Flows are numbered in the order RunScenario creates
+// them: epoch by epoch, within an epoch home by home, and within a home
+// in flow table order, so with one home and no epochs flow is the row
+// of the flow table.
+class TcpStateRecorder
+{
+public:
+  enum Kind
+  {
+    CWND = 0,
+    SSTHRESH = 1,
+    RTT = 2,
+    BYTES_IN_FLIGHT = 3
+  };
+
+  TcpStateRecorder (std::string fileName);
+
+  void Add (Ptr<Socket> socket, uint32_t flow);
+
+  static void Sample (TcpStateRecorder *recorder, uint32_t flow, uint8_t kind, uint32_t oldValue, uint32_t newValue);
+  static void SampleRtt (TcpStateRecorder *recorder, uint32_t flow, Time oldValue, Time newValue);
+
+private:
+  void Record (uint32_t flow, uint8_t kind, uint32_t value);
+
+  BlockWriter m_out;
+};
+
+TcpStateRecorder::TcpStateRecorder (std::string fileName)
+  : m_out (fileName, 1 << 20)
+{
+  const char header[8] = { 'W', 'N', 'T', 'C', 'P', 0, 2, 0 };
+  m_out.Append (header, sizeof (header));
+}
+
+void
+TcpStateRecorder::Add (Ptr<Socket> socket, uint32_t flow)
+{
+  socket->TraceConnectWithoutContext ("CongestionWindow", MakeBoundCallback (&TcpStateRecorder::Sample, this, flow, (uint8_t) CWND));
+  socket->TraceConnectWithoutContext ("SlowStartThreshold", MakeBoundCallback (&TcpStateRecorder::Sample, this, flow, (uint8_t) SSTHRESH));
+  socket->TraceConnectWithoutContext ("BytesInFlight", MakeBoundCallback (&TcpStateRecorder::Sample, this, flow, (uint8_t) BYTES_IN_FLIGHT));
+  socket->TraceConnectWithoutContext ("RTT", MakeBoundCallback (&TcpStateRecorder::SampleRtt, this, flow));
+}
+
+void
+TcpStateRecorder::Sample (TcpStateRecorder *recorder, uint32_t flow, uint8_t kind, uint32_t oldValue, uint32_t newValue)
+{
+  recorder->Record (flow, kind, newValue);
+}
+
+void
+TcpStateRecorder::SampleRtt (TcpStateRecorder *recorder, uint32_t flow, Time oldValue, Time newValue)
+{
+  recorder->Record (flow, RTT, static_cast<uint32_t> (std::min<int64_t> (newValue.GetMicroSeconds (), UINT32_MAX)));
+}
+
+void
+TcpStateRecorder::Record (uint32_t flow, uint8_t kind, uint32_t value)
+{
+  int64_t now = Simulator::Now ().GetNanoSeconds ();
+  uint8_t *record = m_out.Reserve (20);
+  std::copy (reinterpret_cast<const uint8_t *> (&now), reinterpret_cast<const uint8_t *> (&now) + 8, record);
+  std::copy (reinterpret_cast<const uint8_t *> (&flow), reinterpret_cast<const uint8_t *> (&flow) + 4, record + 8);
+  record[12] = kind;
+  record[13] = 0;
+  record[14] = 0;
+  record[15] = 0;
+  std::copy (reinterpret_cast<const uint8_t *> (&value), reinterpret_cast<const uint8_t *> (&value) + 4, record + 16);
+}
+
+class BatchedWalkMobilityModel;
+
+// Random walk of many stations advanced together.  Positions and
+// velocities live in flat arrays and one event per time step moves
+// every station, reflecting at the bounds, instead of each
+// RandomWalk2dMobilityModel working out its position on every query.
+// Legs follow that model's defaults: 1 m at a speed uniform in 2-4 m/s
+// and a uniform direction.  Queries return the position at the last
+// step, so they lag by up to one step.
+class BatchedWalkManager : public Object
+{
+public:
+  BatchedWalkManager (Rectangle bounds, Time step);
+
+  void Add (Ptr<BatchedWalkMobilityModel> model);
+  void Start (void);
+
+  Vector GetPosition (uint32_t i) const;
+  void SetPosition (uint32_t i, const Vector &position);
+  Vector GetVelocity (uint32_t i) const;
+
+private:
+  void Advance (void);
+  void NewLeg (uint32_t i);
+
+  Rectangle                          m_bounds;
+  Time                               m_step;
+  Ptr<UniformRandomVariable>         m_random;
+  std::vector<BatchedWalkMobilityModel *> m_models; //owned by their nodes
+  std::vector<double>                m_x;
+  std::vector<double>                m_y;
+  std::vector<double>                m_z;
+  std::vector<double>                m_vx;
+  std::vector<double>                m_vy;
+  std::vector<double>                m_legEnd; //seconds
+};
+
+// thin MobilityModel of one station of a BatchedWalkManager
+class BatchedWalkMobilityModel : public MobilityModel
+{
+public:
+  static TypeId GetTypeId (void);
+  BatchedWalkMobilityModel ();
+
+  void Attach (BatchedWalkManager *manager, uint32_t index);
+  Vector GetInitialPosition (void) const;
+  void CourseChanged (void) const;
+
+private:
+  virtual Vector DoGetPosition (void) const;
+  virtual void DoSetPosition (const Vector &position);
+  virtual Vector DoGetVelocity (void) const;
+
+  BatchedWalkManager *m_manager; //kept alive by the scenario until Simulator::Destroy
+  uint32_t            m_index;
+  Vector              m_position; //until attached
+};
+
+NS_OBJECT_ENSURE_REGISTERED (BatchedWalkMobilityModel);
+
+TypeId
+BatchedWalkMobilityModel::GetTypeId (void)
+{
+  static TypeId tid = TypeId ("ns3::BatchedWalkMobilityModel")
+    .SetParent<MobilityModel> ()
+    .AddConstructor<BatchedWalkMobilityModel> ()
+  ;
+  return tid;
+}
+
+BatchedWalkMobilityModel::BatchedWalkMobilityModel ()
+  : m_manager (0),
+    m_index (0)
+{
+}
+
+void
+BatchedWalkMobilityModel::Attach (BatchedWalkManager *manager, uint32_t index)
+{
+  m_manager = manager;
+  m_index = index;
+}
+
+Vector
+BatchedWalkMobilityModel::GetInitialPosition (void) const
+{
+  return m_position;
+}
+
+void
+BatchedWalkMobilityModel::CourseChanged (void) const
+{
+  NotifyCourseChange ();
+}
+
+Vector
+BatchedWalkMobilityModel::DoGetPosition (void) const
+{
+  return m_manager ? m_manager->GetPosition (m_index) : m_position;
+}
+
+void
+BatchedWalkMobilityModel::DoSetPosition (const Vector &position)
+{
+  if (m_manager)
+    {
+      m_manager->SetPosition (m_index, position);
+    }
+  else
+    {
+      m_position = position;
+    }
+  NotifyCourseChange ();
+}
+
+Vector
+BatchedWalkMobilityModel::DoGetVelocity (void) const
+{
+  return m_manager ? m_manager->GetVelocity (m_index) : Vector (0, 0, 0);
+}
+
+BatchedWalkManager::BatchedWalkManager (Rectangle bounds, Time step)
+  : m_bounds (bounds),
+    m_step (step)
+{
+  m_random = CreateObject<UniformRandomVariable> ();
+}
+
+// the model's node must already be placed
+void
+BatchedWalkManager::Add (Ptr<BatchedWalkMobilityModel> model)
+{
+  Vector position = model->GetInitialPosition ();
+  uint32_t i = m_models.size ();
+  m_models.push_back (PeekPointer (model));
+  m_x.push_back (position.x);
+  m_y.push_back (position.y);
+  m_z.push_back (position.z);
+  m_vx.push_back (0);
+  m_vy.push_back (0);
+  m_legEnd.push_back (0);
+  model->Attach (this, i);
+  NewLeg (i);
+}
+
+void
+BatchedWalkManager::Start (void)
+{
+  Simulator::Schedule (m_step, &BatchedWalkManager::Advance, this);
+}
+
+Vector
+BatchedWalkManager::GetPosition (uint32_t i) const
+{
+  return Vector (m_x[i], m_y[i], m_z[i]);
+}
+
+void
+BatchedWalkManager::SetPosition (uint32_t i, const Vector &position)
+{
+  m_x[i] = position.x;
+  m_y[i] = position.y;
+  m_z[i] = position.z;
+}
+
+Vector
+BatchedWalkManager::GetVelocity (uint32_t i) const
+{
+  return Vector (m_vx[i], m_vy[i], 0);
+}
+
+void
+BatchedWalkManager::NewLeg (uint32_t i)
+{
+  double speed = m_random->GetValue (2.0, 4.0);
+  double direction = m_random->GetValue (0.0, 6.283184);
+  m_vx[i] = speed * std::cos (direction);
+  m_vy[i] = speed * std::sin (direction);
+  m_legEnd[i] = Simulator::Now ().GetSeconds () + 1.0 / speed;
+}
+
+void
+BatchedWalkManager::Advance (void)
+{
+  double dt = m_step.GetSeconds ();
+  uint32_t n = m_x.size ();
+  // one pass over the arrays the compiler can vectorise
+  double *x = n ? &m_x[0] : 0;
+  double *y = n ? &m_y[0] : 0;
+  const double *vx = n ? &m_vx[0] : 0;
+  const double *vy = n ? &m_vy[0] : 0;
+  for (uint32_t i = 0; i < n; ++i)
+    {
+      x[i] += vx[i] * dt;
+      y[i] += vy[i] * dt;
+    }
+  double now = Simulator::Now ().GetSeconds ();
+  for (uint32_t i = 0; i < n; ++i)
+    {
+      bool changed = false;
+      if (m_x[i] < m_bounds.xMin || m_x[i] > m_bounds.xMax)
+        {
+          m_x[i] = m_x[i] < m_bounds.xMin ? 2 * m_bounds.xMin - m_x[i] : 2 * m_bounds.xMax - m_x[i];
+          m_vx[i] = -m_vx[i];
+          changed = true;
+        }
+      if (m_y[i] < m_bounds.yMin || m_y[i] > m_bounds.yMax)
+        {
+          m_y[i] = m_y[i] < m_bounds.yMin ? 2 * m_bounds.yMin - m_y[i] : 2 * m_bounds.yMax - m_y[i];
+          m_vy[i] = -m_vy[i];
+          changed = true;
+        }
+      if (now >= m_legEnd[i])
+        {
+          NewLeg (i);
+          changed = true;
+        }
+      if (changed)
+        {
+          m_models[i]->CourseChanged ();
+        }
+    }
+  Simulator::Schedule (m_step, &BatchedWalkManager::Advance, this);
+}
+
+// Propagation loss that keeps, per channel, which pairs of PHYs can hear
+// each other at all: a pair is in range when the wrapped model gives at
+// least the cutoff power for the PHYs' default transmit power.  The
+// wrapped model has to lose more with distance, as the log distance
+// model does, so that this is a cutoff distance found once by bisection.
+// The table is updated for one node whenever its mobility model reports
+// a course change, by a squared distance pass over position arrays, and
+// a transmission towards an out-of-range PHY gets a power far below any
+// receive sensitivity, so YansWifiChannel drops it before the PHY, the
+// interference helper or an Rx trace ever see it.
+// YansWifiChannel::Send is not virtual, so the per-PHY fan-out event
+// itself remains; what is saved is the reception work behind it.
+// Signals below the cutoff no longer add to the interference.
+class CutoffPropagationLossModel : public PropagationLossModel
+{
+public:
+  static TypeId GetTypeId (void);
+  CutoffPropagationLossModel ();
+
+  void Setup (Ptr<PropagationLossModel> model, double cutoffDbm);
+  void Add (Ptr<MobilityModel> mobility);
+
+private:
+  virtual double DoCalcRxPower (double txPowerDbm, Ptr<MobilityModel> a, Ptr<MobilityModel> b) const;
+  virtual int64_t DoAssignStreams (int64_t stream);
+
+  void CourseChanged (Ptr<const MobilityModel> mobility);
+  void Update (uint32_t i);
+
+  Ptr<PropagationLossModel>                        m_model;
+  double                                           m_cutoffDbm;
+  double                                           m_cutoffDistance2; //squared metres
+  std::vector<double>                              m_x; //positions and squared distances for Update
+  std::vector<double>                              m_y;
+  std::vector<double>                              m_distance2;
+  std::vector<Ptr<MobilityModel> >                 m_mobility;
+  std::unordered_map<const MobilityModel *, uint32_t> m_index;
+  std::vector<std::vector<uint8_t> >               m_inRange; //symmetric, indexed like m_mobility
+};
+
+NS_OBJECT_ENSURE_REGISTERED (CutoffPropagationLossModel);
+
+TypeId
+CutoffPropagationLossModel::GetTypeId (void)
+{
+  static TypeId tid = TypeId ("ns3::CutoffPropagationLossModel")
+    .SetParent<PropagationLossModel> ()
+    .AddConstructor<CutoffPropagationLossModel> ()
+  ;
+  return tid;
+}
+
+CutoffPropagationLossModel::CutoffPropagationLossModel ()
+  : m_cutoffDbm (-82),
+    m_cutoffDistance2 (0)
+{
+}
+
+void
+CutoffPropagationLossModel::Setup (Ptr<PropagationLossModel> model, double cutoffDbm)
+{
+  const double txPowerDbm = 16.0206; //YansWifiPhy's TxPowerStart/End default
+  m_model = model;
+  m_cutoffDbm = cutoffDbm;
+  Ptr<ConstantPositionMobilityModel> a = CreateObject<ConstantPositionMobilityModel> ();
+  Ptr<ConstantPositionMobilityModel> b = CreateObject<ConstantPositionMobilityModel> ();
+  double inside = 0.0;
+  double outside = 1e5;
+  a->SetPosition (Vector (0, 0, 0));
+  for (uint32_t i = 0; i < 64; ++i)
+    {
+      double middle = (inside + outside) / 2;
+      b->SetPosition (Vector (middle, 0, 0));
+      if (m_model->CalcRxPower (txPowerDbm, a, b) >= cutoffDbm)
+        {
+          inside = middle;
+        }
+      else
+        {
+          outside = middle;
+        }
+    }
+  m_cutoffDistance2 = inside * inside;
+}
+
+// the node of every PHY on the channel has to be added once it is placed
+void
+CutoffPropagationLossModel::Add (Ptr<MobilityModel> mobility)
+{
+  uint32_t i = m_mobility.size ();
+  m_mobility.push_back (mobility);
+  m_index[PeekPointer (mobility)] = i;
+  for (uint32_t j = 0; j < i; ++j)
+    {
+      m_inRange[j].push_back (0);
+    }
+  m_inRange.push_back (std::vector<uint8_t> (i + 1, 1));
+  m_x.push_back (0);
+  m_y.push_back (0);
+  m_distance2.push_back (0);
+  Update (i);
+  mobility->TraceConnectWithoutContext ("CourseChange", MakeCallback (&CutoffPropagationLossModel::CourseChanged, this));
+}
+
+void
+CutoffPropagationLossModel::CourseChanged (Ptr<const MobilityModel> mobility)
+{
+  Update (m_index[PeekPointer (mobility)]);
+}
+
+// the channel is planar: heights are ignored
+void
+CutoffPropagationLossModel::Update (uint32_t i)
+{
+  uint32_t n = m_mobility.size ();
+  for (uint32_t j = 0; j < n; ++j)
+    {
+      Vector position = m_mobility[j]->GetPosition ();
+      m_x[j] = position.x;
+      m_y[j] = position.y;
+    }
+  const double *x = &m_x[0];
+  const double *y = &m_y[0];
+  double *distance2 = &m_distance2[0];
+  double xi = x[i];
+  double yi = y[i];
+  for (uint32_t j = 0; j < n; ++j)
+    {
+      double dx = x[j] - xi;
+      double dy = y[j] - yi;
+      distance2[j] = dx * dx + dy * dy;
+    }
+  for (uint32_t j = 0; j < n; ++j)
+    {
+      if (j != i)
+        {
+          bool inRange = distance2[j] <= m_cutoffDistance2;
+          m_inRange[i][j] = inRange;
+          m_inRange[j][i] = inRange;
+        }
+    }
+}
+
+double
+CutoffPropagationLossModel::DoCalcRxPower (double txPowerDbm, Ptr<MobilityModel> a, Ptr<MobilityModel> b) const
+{
+  std::unordered_map<const MobilityModel *, uint32_t>::const_iterator i = m_index.find (PeekPointer (a));
+  std::unordered_map<const MobilityModel *, uint32_t>::const_iterator j = m_index.find (PeekPointer (b));
+  if (i != m_index.end () && j != m_index.end () && !m_inRange[i->second][j->second])
+    {
+      return -1000;
+    }
+  return m_model->CalcRxPower (txPowerDbm, a, b);
+}
+
+int64_t
+CutoffPropagationLossModel::DoAssignStreams (int64_t stream)
+{
+  return m_model->AssignStreams (stream);
+}
+
+// Error rate model answering from a table filled on demand from the
+// exact model.  Per mode and frame size class (nbits rounded up to a
+// power of two) it keeps ln (success rate) / nbits at SNRs spaced
+// stepDb apart; a lookup interpolates that per-bit value linearly in dB
+// and raises it to the chunk's nbits, which is exact for the models
+// that treat bit errors as independent and close for the others.  SNRs
+// outside the table go to the exact model.  With validation every
+// lookup also asks the exact model and the deviation is reported.  The
+// home BSS uses one channel width, so the mode alone picks the row.
+class CachedErrorRateModel : public ErrorRateModel
+{
+public:
+  static TypeId GetTypeId (void);
+  CachedErrorRateModel ();
+
+  void Setup (Ptr<ErrorRateModel> exact, double stepDb, bool validate);
+  void Report (std::ostream &out) const;
+
+private:
+  virtual double DoGetChunkSuccessRate (WifiMode mode, const WifiTxVector& txVector, double snr, uint64_t nbits,
+                                        uint8_t numRxAntennas, WifiPpduField field, uint16_t staId) const;
+
+  enum
+  {
+    SIZE_CLASSES = 32,
+  };
+  static const double MIN_SNR_DB;
+  static const double MAX_SNR_DB;
+
+  Ptr<ErrorRateModel>                        m_exact;
+  double                                     m_stepDb;
+  bool                                       m_validate;
+  uint32_t                                   m_buckets;
+  mutable std::vector<std::vector<double> >  m_tables; //[mode uid * SIZE_CLASSES + class][bucket], NaN until filled
+  mutable uint64_t                           m_lookups;
+  mutable uint64_t                           m_fills;
+  mutable double                             m_maxError; //of the success rate, with validation
+  mutable double                             m_sumError;
+};
+
+const double CachedErrorRateModel::MIN_SNR_DB = -10;
+const double CachedErrorRateModel::MAX_SNR_DB = 60;
+
+NS_OBJECT_ENSURE_REGISTERED (CachedErrorRateModel);
+
+TypeId
+CachedErrorRateModel::GetTypeId (void)
+{
+  static TypeId tid = TypeId ("ns3::CachedErrorRateModel")
+    .SetParent<ErrorRateModel> ()
+    .AddConstructor<CachedErrorRateModel> ()
+  ;
+  return tid;
+}
+
+CachedErrorRateModel::CachedErrorRateModel ()
+  : m_stepDb (0.1),
+    m_validate (false),
+    m_buckets (0),
+    m_lookups (0),
+    m_fills (0),
+    m_maxError (0),
+    m_sumError (0)
+{
+}
+
+void
+CachedErrorRateModel::Setup (Ptr<ErrorRateModel> exact, double stepDb, bool validate)
+{
+  m_exact = exact;
+  m_stepDb = stepDb;
+  m_validate = validate;
+  m_buckets = static_cast<uint32_t> ((MAX_SNR_DB - MIN_SNR_DB) / stepDb) + 1;
+  m_tables.clear ();
+}
+
+double
+CachedErrorRateModel::DoGetChunkSuccessRate (WifiMode mode, const WifiTxVector& txVector, double snr, uint64_t nbits,
+                                             uint8_t numRxAntennas, WifiPpduField field, uint16_t staId) const
+{
+  double x = (10 * std::log10 (snr) - MIN_SNR_DB) / m_stepDb;
+  uint32_t sizeClass = 0;
+  while (sizeClass < SIZE_CLASSES && (uint64_t (1) << sizeClass) < nbits)
+    {
+      ++sizeClass;
+    }
+  if (nbits == 0 || !(x >= 0) || x >= m_buckets - 1 || sizeClass == SIZE_CLASSES)
+    {
+      return m_exact->GetChunkSuccessRate (mode, txVector, snr, nbits, numRxAntennas, field, staId);
+    }
+  uint32_t row = mode.GetUid () * SIZE_CLASSES + sizeClass;
+  if (row >= m_tables.size ())
+    {
+      m_tables.resize (row + 1);
+    }
+  std::vector<double> &table = m_tables[row];
+  if (table.empty ())
+    {
+      table.assign (m_buckets, std::numeric_limits<double>::quiet_NaN ());
+    }
+  uint32_t bucket = static_cast<uint32_t> (x);
+  for (uint32_t b = bucket; b <= bucket + 1; ++b)
+    {
+      if (std::isnan (table[b]))
+        {
+          uint64_t classBits = uint64_t (1) << sizeClass;
+          double edgeSnr = std::pow (10.0, (MIN_SNR_DB + b * m_stepDb) / 10);
+          double rate = m_exact->GetChunkSuccessRate (mode, txVector, edgeSnr, classBits, numRxAntennas, field, staId);
+          table[b] = std::log (std::max (rate, 1e-300)) / classBits;
+          ++m_fills;
+        }
+    }
+  double w = x - bucket;
+  double rate = std::exp (((1 - w) * table[bucket] + w * table[bucket + 1]) * nbits);
+  ++m_lookups;
+  if (m_validate)
+    {
+      double error = std::fabs (rate - m_exact->GetChunkSuccessRate (mode, txVector, snr, nbits, numRxAntennas, field, staId));
+      m_maxError = std::max (m_maxError, error);
+      m_sumError += error;
+    }
+  return rate;
+}
+
+void
+CachedErrorRateModel::Report (std::ostream &out) const
+{
+  out << "error rate table: " << m_lookups << " lookups, " << m_fills << " entries computed";
+  if (m_validate && m_lookups > 0)
+    {
+      out << ", success rate deviation max " << m_maxError << " mean " << m_sumError / m_lookups;
+    }
+  out << std::endl;
+}
+
+// DefaultSimulatorImpl that times every event handler.  Events are
+// wrapped when scheduled and, when they run, charged to a subsystem
+// guessed from the event's type: the class whose member function the
+// event calls is the earliest class name in the mangled type name.
+// Trace sinks run inside the event that fires them, so for example pcap
+// writing is charged to the device or PHY event producing the frame and
+// "tracing" only holds the measurement code's own events.
+class ProfilingSimulatorImpl : public DefaultSimulatorImpl
+{
+public:
+  enum Subsystem
+  {
+    WIFI_PHY,
+    WIFI_MAC,
+    POINT_TO_POINT,
+    TCP,
+    INTERNET,
+    APPLICATIONS,
+    TRACING,
+    OTHER,
+    N_SUBSYSTEMS
+  };
+
+  static TypeId GetTypeId (void);
+  ProfilingSimulatorImpl ();
+
+  virtual EventId Schedule (const Time &delay, EventImpl *event);
+  virtual void ScheduleWithContext (uint32_t context, const Time &delay, EventImpl *event);
+  virtual EventId ScheduleNow (EventImpl *event);
+
+  static const char *GetSubsystemName (uint32_t subsystem);
+  uint64_t GetEvents (uint32_t subsystem) const;
+  double GetSeconds (uint32_t subsystem) const;
+
+private:
+  class TimedEvent : public EventImpl
+  {
+  public:
+    TimedEvent (ProfilingSimulatorImpl *profiler, EventImpl *event, uint32_t subsystem);
+    virtual ~TimedEvent ();
+
+  private:
+    virtual void Notify (void);
+
+    ProfilingSimulatorImpl *m_profiler;
+    EventImpl *m_event; //owns the reference the scheduler would have held
+    uint32_t m_subsystem;
+  };
+
+  EventImpl *Wrap (EventImpl *event);
+
+  std::unordered_map<std::type_index, uint32_t> m_subsystemOf;
+  uint64_t m_events[N_SUBSYSTEMS];
+  int64_t m_nanoseconds[N_SUBSYSTEMS];
+};
+
+NS_OBJECT_ENSURE_REGISTERED (ProfilingSimulatorImpl);
+
+TypeId
+ProfilingSimulatorImpl::GetTypeId (void)
+{
+  static TypeId tid = TypeId ("ns3::ProfilingSimulatorImpl")
+    .SetParent<DefaultSimulatorImpl> ()
+    .AddConstructor<ProfilingSimulatorImpl> ()
+  ;
+  return tid;
+}
+
+ProfilingSimulatorImpl::ProfilingSimulatorImpl ()
+{
+  std::fill (m_events, m_events + N_SUBSYSTEMS, 0);
+  std::fill (m_nanoseconds, m_nanoseconds + N_SUBSYSTEMS, 0);
+}
+
+const char *
+ProfilingSimulatorImpl::GetSubsystemName (uint32_t subsystem)
+{
+  static const char *names[N_SUBSYSTEMS] = { "wifi_phy", "wifi_mac", "point_to_point", "tcp",
+                                             "internet", "applications", "tracing", "other" };
+  return names[subsystem];
+}
+
+uint64_t
+ProfilingSimulatorImpl::GetEvents (uint32_t subsystem) const
+{
+  return m_events[subsystem];
+}
+
+double
+ProfilingSimulatorImpl::GetSeconds (uint32_t subsystem) const
+{
+  return m_nanoseconds[subsystem] / 1e9;
+}
+
+EventImpl *
+ProfilingSimulatorImpl::Wrap (EventImpl *event)
+{
+  std::type_index type (typeid (*event));
+  std::unordered_map<std::type_index, uint32_t>::const_iterator known = m_subsystemOf.find (type);
+  if (known != m_subsystemOf.end ())
+    {
+      return new TimedEvent (this, event, known->second);
+    }
+  static const struct
+  {
+    const char *keyword;
+    uint32_t subsystem;
+  } keywords[] = {
+    { "WifiPhy", WIFI_PHY }, { "PhyEntity", WIFI_PHY }, { "InterferenceHelper", WIFI_PHY },
+    { "WifiChannel", WIFI_PHY }, { "WifiPpdu", WIFI_PHY },
+    { "WifiMac", WIFI_MAC }, { "Txop", WIFI_MAC }, { "ChannelAccessManager", WIFI_MAC },
+    { "FrameExchangeManager", WIFI_MAC }, { "MacLow", WIFI_MAC }, { "WifiNetDevice", WIFI_MAC },
+    { "WifiRemoteStationManager", WIFI_MAC }, { "BlockAck", WIFI_MAC },
+    { "PointToPoint", POINT_TO_POINT },
+    { "Tcp", TCP }, { "RttEstimator", TCP },
+    { "Ipv4", INTERNET }, { "Arp", INTERNET }, { "Icmpv4", INTERNET }, { "Udp", INTERNET },
+    { "TrafficControl", INTERNET }, { "QueueDisc", INTERNET },
+    { "MyApp", APPLICATIONS }, { "PortSink", APPLICATIONS }, { "Application", APPLICATIONS },
+    { "ThroughputMonitor", TRACING }, { "TcpStateRecorder", TRACING }, { "Pcap", TRACING },
+    { "FlowMonitor", TRACING }, { "QueueMonitor", TRACING },
+  };
+  std::string name = type.name ();
+  std::string::size_type best = std::string::npos;
+  std::string::size_type bestLength = 0;
+  uint32_t subsystem = OTHER;
+  for (uint32_t i = 0; i < sizeof (keywords) / sizeof (keywords[0]); ++i)
+    {
+      std::string keyword = keywords[i].keyword;
+      std::string::size_type at = name.find (keyword);
+      // earliest match wins, the longer keyword on a tie (TcpStateRecorder
+      // before Tcp)
+      if (at != std::string::npos && (at < best || (at == best && keyword.size () > bestLength)))
+        {
+          best = at;
+          bestLength = keyword.size ();
+          subsystem = keywords[i].subsystem;
+        }
+    }
+  m_subsystemOf[type] = subsystem;
+  return new TimedEvent (this, event, subsystem);
+}
+
+EventId
+ProfilingSimulatorImpl::Schedule (const Time &delay, EventImpl *event)
+{
+  return DefaultSimulatorImpl::Schedule (delay, Wrap (event));
+}
+
+void
+ProfilingSimulatorImpl::ScheduleWithContext (uint32_t context, const Time &delay, EventImpl *event)
+{
+  DefaultSimulatorImpl::ScheduleWithContext (context, delay, Wrap (event));
+}
+
+EventId
+ProfilingSimulatorImpl::ScheduleNow (EventImpl *event)
+{
+  return DefaultSimulatorImpl::ScheduleNow (Wrap (event));
+}
+
+ProfilingSimulatorImpl::TimedEvent::TimedEvent (ProfilingSimulatorImpl *profiler, EventImpl *event, uint32_t subsystem)
+  : m_profiler (profiler),
+    m_event (event),
+    m_subsystem (subsystem)
+{
+}
+
+ProfilingSimulatorImpl::TimedEvent::~TimedEvent ()
+{
+  m_event->Unref ();
+}
+
+void
+ProfilingSimulatorImpl::TimedEvent::Notify (void)
+{
+  std::chrono::steady_clock::time_point begin = std::chrono::steady_clock::now ();
+  m_event->Invoke ();
+  m_profiler->m_nanoseconds[m_subsystem] += std::chrono::duration_cast<std::chrono::nanoseconds> (
+      std::chrono::steady_clock::now () - begin).count ();
+  ++m_profiler->m_events[m_subsystem];
+}
+
+struct Home //the nodes and devices of one household
+{
+  NodeContainer wired;              //router (also the AP), PC1, PC2
+  NodeContainer stas;
+  NodeContainer senders;            //in the order used by SourceIndex
+  NetDeviceContainer pc1Devices;    //router, PC1
+  NetDeviceContainer pc2Devices;    //router, PC2
+  NetDeviceContainer uplinkDevices; //router, ISP server or aggregation router
+  NetDeviceContainer staDevices;
+  NetDeviceContainer apDevices;
+  Ptr<CutoffPropagationLossModel> cutoff; //of the home's channel, null without --rxCutoff
+};
+
+struct FlowSpec //one row of the flow table
+{
+  std::string source; //pc1, pc2 or staN
+  uint16_t port;      //sink port at the ISP node
+  DataRate rate;      //MyApp sending rate
+  bool saturate;      //rate "max": fill the socket instead of pacing
+  double start;       //seconds
+  double stop;        //seconds, 0 means until the end of the simulation
+};
+
+struct TrafficEpoch //a flow table run on the topology built for the first one
+{
+  std::vector<FlowSpec> flows; //start and stop relative to the epoch's start
+  double duration;
+};
+
+struct ScenarioConfig //everything a single run needs
+{
+  uint32_t nWifi;
+  std::string placement;      //STA layout: grid, disc or auto
+  bool tracing;
+  std::string capture;        //devices to trace: all or a list of pc1, pc2, isp, ap, staN
+  uint32_t snapLen;           //bytes kept per captured frame, 0 for all
+  uint32_t captureBlock;      //bytes buffered before each capture file write
+  double errorRate;           //at the router's PC1 device
+  double simulationTime;      //seconds
+  std::string linkRate;       //point-to-point links to the PCs and the ISP
+  std::string linkDelay;
+  std::string throughputFile; //windowed goodput CSV, empty for none
+  double throughputInterval;  //seconds
+  bool reusePayload;          //MyApp sends copies of one payload packet
+  uint32_t paceBurst;         //MyApp packets per pacing wakeup, 0 for a timer per packet
+  double paceInterval;        //seconds between pacing wakeups, 0 to derive it from paceBurst
+  std::string tcpStateFile;   //binary cwnd/ssthresh/RTT/in-flight series, empty for none
+  std::string flowStatsFile;  //FlowMonitor per-flow table, empty for none
+  std::string protocol;       //of every flow: tcp or udp
+  std::string udpStatsFile;   //loss, reordering and delay of UDP flows, empty for none
+  std::string latencyFile;    //per-flow delay percentiles, empty for none
+  std::string queueDisc;      //on the routers' uplinks: fq_codel, codel, pie, red, pfifo_fast (plain FIFO baseline),
+                              //empty for ns-3's default (fq_codel over a 100 packet device queue)
+  std::string queueFile;      //sampled uplink queue length and sojourn time, empty for none
+  double queueInterval;       //seconds between queue samples
+  std::string profileFile;    //JSON run profile, empty for none
+  bool distributed;           //ISP node on MPI rank 1, the homes on the others
+  bool preAssociate;          //STAs probe at once and their flows start on association
+  double rxCutoff;            //dBm below which a PHY is out of range, 0 for no cutoff
+  double mobilityStep;        //seconds between batched STA walk updates, 0 for RandomWalk2d
+  std::string scheduler;      //event queue: map, heap, list, calendar or priority
+  double errorTableStep;      //dB between error rate table entries, 0 for the exact model
+  bool errorTableValidate;    //compare every table lookup with the exact model
+  uint32_t homes;             //households sharing the ISP server
+  std::string aggregationRate; //link from the homes' aggregation router to the ISP
+  std::string aggregationDelay;
+  std::vector<TrafficEpoch> epochs; //run after config.flows, empty for none
+  double epochGap;            //seconds without new traffic between epochs
+  std::string runTag;         //added to output file names of replications
+  std::vector<FlowSpec> flows;
+};
+
+struct ScenarioResult //what one run measured
+{
+  std::map<uint16_t, uint64_t> rxBytes; //total bytes received per sink port
+  std::map<uint16_t, double> activeSeconds; //per sink port, start to stop of its flows
+  double wallSeconds;                   //spent in Simulator::Run
+  uint64_t events;                      //executed by the simulator
+  long peakRssKb;                       //of the whole process so far
+  std::map<uint16_t, LatencyHistogram> latency; //per sink port, empty without --latencyFile
+};
+
+// "goodput.csv" becomes "goodput-run3.csv" and the pcap prefix "p2p"
+// becomes "p2p-run3", so replications running side by side do not
+// write the same files
+static std::string
+TaggedName (const std::string &name, const std::string &tag)
+{
+  if (tag.empty ())
+    {
+      return name;
+    }
+  std::string::size_type dot = name.rfind ('.');
+  if (dot == std::string::npos || name.find ('/', dot) != std::string::npos)
+    {
+      return name + "-" + tag;
+    }
+  return name.substr (0, dot) + "-" + tag + name.substr (dot);
+}
+
+// sets the rate of flow from text, "max" for a saturated sender; false
+// for text DataRate cannot parse, which its string constructor would
+// abort on
+static bool
+ParseRate (const std::string &text, FlowSpec &flow)
+{
+  flow.saturate = text == "max";
+  DataRateValue value (DataRate (0));
+  if (!flow.saturate && !value.DeserializeFromString (text, MakeDataRateChecker ()))
+    {
+      return false;
+    }
+  flow.rate = value.Get ();
+  return true;
+}
+
+// parses one "source:port[:rate[:start[:stop]]]" row; blanks may be used
+// instead of colons and a rate of "max" selects a saturated sender
+static bool
+ParseFlow (std::string text, const std::string &defaultRate, FlowSpec &flow)
+{
+  std::replace (text.begin (), text.end (), ':', ' ');
+  std::istringstream in (text);
+  uint32_t port = 0;
+  std::string rate = defaultRate;
+  double start = -1; //--flowStart, filled in by BuildFlowTable
+  double stop = 0.0;
+  if (!(in >> flow.source >> port) || port == 0 || port > 65535)
+    {
+      return false;
+    }
+  // a failed extraction zeroes its target, hence the temporaries
+  double value;
+  if (in >> rate && in >> value)
+    {
+      start = value;
+      if (in >> value)
+        {
+          stop = value;
+        }
+    }
+  flow.port = port;
+  if (!ParseRate (rate, flow))
+    {
+      return false;
+    }
+  flow.start = start;
+  flow.stop = stop;
+  return true;
+}
+
+static bool
+ParseFlowList (const std::string &list, const std::string &defaultRate, std::vector<FlowSpec> &flows)
+{
+  std::istringstream in (list);
+  std::string row;
+  while (std::getline (in, row, ','))
+    {
+      FlowSpec flow;
+      if (!ParseFlow (row, defaultRate, flow))
+        {
+          std::cout << "bad flow \"" << row << "\"" << std::endl;
+          return false;
+        }
+      flows.push_back (flow);
+    }
+  return true;
+}
+
+static bool
+ReadFlowFile (const std::string &path, const std::string &defaultRate, std::vector<FlowSpec> &flows)
+{
+  std::ifstream in (path.c_str ());
+  if (!in)
+    {
+      std::cout << "cannot open flow file " << path << std::endl;
+      return false;
+    }
+  std::string line;
+  uint32_t lineNumber = 0;
+  while (std::getline (in, line))
+    {
+      ++lineNumber;
+      line = line.substr (0, line.find ('#'));
+      if (line.find_first_not_of (" \t\r") == std::string::npos)
+        {
+          continue;
+        }
+      FlowSpec flow;
+      if (!ParseFlow (line, defaultRate, flow))
+        {
+          std::cout << path << ":" << lineNumber << ": bad flow \"" << line << "\"" << std::endl;
+          return false;
+        }
+      flows.push_back (flow);
+    }
+  return true;
+}
+
+// the flow tables of the original wn_a2_p1..p4 programs: PC2, then PC1,
+// then the STAs, each sending at rate (100Mbps originally) to its own
+// port from 8080 up (rate being checked by the caller).
+// Scenario 4 ("all devices are running") covers every one of the nWifi
+// stations, which is the p4 table for the original 5.
+static std::vector<FlowSpec>
+ScenarioFlows (uint32_t scenario, uint32_t nWifi, const std::string &rate)
+{
+  const uint32_t nFlows[] = { 0, 1, 2, 5, 2 + nWifi };
+  std::vector<FlowSpec> flows;
+  for (uint32_t i = 0; scenario < 5 && i < nFlows[scenario]; ++i)
+    {
+      std::ostringstream source;
+      if (i < 2)
+        {
+          source << (i == 0 ? "pc2" : "pc1");
+        }
+      else
+        {
+          source << "sta" << i - 2;
+        }
+      FlowSpec flow;
+      flow.source = source.str ();
+      flow.port = 8080 + i;
+      ParseRate (rate, flow);
+      flow.start = -1;
+      flow.stop = 0.0;
+      flows.push_back (flow);
+    }
+  return flows;
+}
+
+// index of a flow source in the sender container built by RunScenario:
+// pc1, pc2, then the STAs; -1 if there is no such node
+static int
+SourceIndex (const std::string &source, uint32_t nWifi)
+{
+  if (source == "pc1")
+    {
+      return 0;
+    }
+  if (source == "pc2")
+    {
+      return 1;
+    }
+  if (source.compare (0, 3, "sta") == 0 && source.size () > 3
+      && source.find_first_not_of ("0123456789", 3) == std::string::npos)
+    {
+      uint32_t sta = std::atoi (source.c_str () + 3);
+      if (sta < nWifi)
+        {
+          return 2 + sta;
+        }
+    }
+  return -1;
+}
+
+// Home k uses the four /24 networks 10.a.b.0 with a = 1 + k / 63 and
+// b = (k % 63) * 4 + 1 + j, j being 0 for the PC1 link, 1 for the PC2
+// link, 2 for the BSS and 3 for the uplink; home 0 thus keeps the
+// networks 10.1.1.0 to 10.1.4.0 of the single home.
+static Ipv4Address
+HomeNetwork (uint32_t home, uint32_t j)
+{
+  return Ipv4Address ((10u << 24) | ((1 + home / 63) << 16) | (((home % 63) * 4 + 1 + j) << 8));
+}
+
+// the MPI rank of home k: rank 1 has the ISP side and the homes are dealt
+// round robin over the other ranks (so all on rank 0 with two ranks)
+static uint32_t
+HomeRank (uint32_t home, uint32_t ranks)
+{
+  if (ranks < 3)
+    {
+      return 0;
+    }
+  uint32_t rank = home % (ranks - 1);
+  return rank == 0 ? 0 : rank + 1;
+}
+
+static uint16_t
+LowestPort (const std::vector<FlowSpec> &flows)
+{
+  uint16_t low = flows.empty () ? 0 : 65535;
+  for (std::vector<FlowSpec>::const_iterator flow = flows.begin (); flow != flows.end (); ++flow)
+    {
+      low = std::min (low, flow->port);
+    }
+  return low;
+}
+
+// number of ports from the lowest to the highest of the flow table
+static uint32_t
+PortSpan (const std::vector<FlowSpec> &flows)
+{
+  if (flows.empty ())
+    {
+      return 0;
+    }
+  uint16_t high = 0;
+  for (std::vector<FlowSpec>::const_iterator flow = flows.begin (); flow != flows.end (); ++flow)
+    {
+      high = std::max (high, flow->port);
+    }
+  return high - LowestPort (flows) + 1;
+}
+
+// the flows of the first epoch and of every later one
+static std::vector<FlowSpec>
+AllFlows (const ScenarioConfig &config)
+{
+  std::vector<FlowSpec> flows = config.flows;
+  for (std::vector<TrafficEpoch>::const_iterator epoch = config.epochs.begin (); epoch != config.epochs.end (); ++epoch)
+    {
+      flows.insert (flows.end (), epoch->flows.begin (), epoch->flows.end ());
+    }
+  return flows;
+}
+
+// bytes received on every port while the previous epoch and its drain
+// gap ran; the next epoch's senders start right after
+static void
+RecordEpoch (Ptr<MultiPortSink> sink, std::vector<std::vector<uint64_t> > *snapshots)
+{
+  snapshots->push_back (sink->GetRxBytes ());
+  sink->NextEpoch ();
+}
+
+// static route on the node of device towards network (the default route
+// for 0.0.0.0/0) through gateway
+static void
+AddStaticRoute (Ptr<NetDevice> device, Ipv4Address network, Ipv4Mask mask, Ipv4Address gateway)
+{
+  Ptr<Ipv4> ipv4 = device->GetNode ()->GetObject<Ipv4> ();
+  Ipv4StaticRoutingHelper routing;
+  routing.GetStaticRouting (ipv4)->AddNetworkRouteTo (network, mask, gateway, ipv4->GetInterfaceForDevice (device));
+}
+
+// one CSV row per FlowMonitor flow towards a sink port, i.e. the data
+// direction of every flow of the flow table (ACK flows are left out)
+static void
+WriteFlowStats (const std::string &fileName, Ptr<FlowMonitor> monitor, Ptr<Ipv4FlowClassifier> classifier,
+                const std::set<uint16_t> &ports)
+{
+  monitor->CheckForLostPackets ();
+  std::ofstream out (fileName.c_str ());
+  out << "port,source,tx_packets,rx_packets,lost_packets,tx_bytes,rx_bytes,"
+      << "throughput_mbps,mean_delay_ms,mean_jitter_ms\n";
+  const FlowMonitor::FlowStatsContainer &stats = monitor->GetFlowStats ();
+  for (FlowMonitor::FlowStatsContainer::const_iterator flow = stats.begin (); flow != stats.end (); ++flow)
+    {
+      Ipv4FlowClassifier::FiveTuple tuple = classifier->FindFlow (flow->first);
+      if (ports.find (tuple.destinationPort) == ports.end ())
+        {
+          continue;
+        }
+      const FlowMonitor::FlowStats &f = flow->second;
+      double seconds = (f.timeLastRxPacket - f.timeFirstTxPacket).GetSeconds ();
+      out << tuple.destinationPort << "," << tuple.sourceAddress << ","
+          << f.txPackets << "," << f.rxPackets << "," << f.lostPackets << ","
+          << f.txBytes << "," << f.rxBytes << ","
+          << (f.rxPackets > 0 && seconds > 0 ? f.rxBytes * 8 / seconds / 1e6 : 0) << ","
+          << (f.rxPackets > 0 ? f.delaySum.GetSeconds () * 1e3 / f.rxPackets : 0) << ","
+          << (f.rxPackets > 1 ? f.jitterSum.GetSeconds () * 1e3 / (f.rxPackets - 1) : 0) << "\n";
+    }
+}
+
+// one CSV row per UDP sink port, delays in milliseconds
+static void
+WriteDatagramStats (const std::string &fileName, Ptr<MultiPortSink> sink, const std::set<uint16_t> &ports)
+{
+  std::ofstream out (fileName.c_str ());
+  out << "port,rx_packets,lost_packets,loss_ratio,reordered_packets,"
+      << "mean_delay_ms,p50_delay_ms,p99_delay_ms,max_delay_ms\n";
+  for (std::set<uint16_t>::const_iterator port = ports.begin (); port != ports.end (); ++port)
+    {
+      const MultiPortSink::DatagramStats &stats = sink->GetDatagramStats ()[*port - sink->GetFirstPort ()];
+      const LatencyHistogram &delay = sink->GetLatency ()[*port - sink->GetFirstPort ()];
+      uint64_t sent = stats.earlierSent + stats.highestSeq + 1; //as far as the sink can tell
+      uint64_t lost = sent > stats.received ? sent - stats.received : 0;
+      out << *port << "," << stats.received << "," << lost << ","
+          << (sent > 0 ? (double) lost / sent : 0) << "," << stats.reordered << ","
+          << delay.GetMean () / 1e6 << "," << delay.GetPercentile (50) / 1e6 << ","
+          << delay.GetPercentile (99) / 1e6 << "," << delay.GetMax () / 1e6 << "\n";
+    }
+}
+
+// one CSV row per sink port, delays in milliseconds
+static void
+WriteLatency (const std::string &fileName, const std::map<uint16_t, LatencyHistogram> &latency)
+{
+  std::ofstream out (fileName.c_str ());
+  out << "port,packets,mean_ms,p50_ms,p99_ms,p99.9_ms,max_ms\n";
+  for (std::map<uint16_t, LatencyHistogram>::const_iterator port = latency.begin (); port != latency.end (); ++port)
+    {
+      const LatencyHistogram &h = port->second;
+      out << port->first << "," << h.GetCount () << "," << h.GetMean () / 1e6 << ","
+          << h.GetPercentile (50) / 1e6 << "," << h.GetPercentile (99) / 1e6 << ","
+          << h.GetPercentile (99.9) / 1e6 << "," << h.GetMax () / 1e6 << "\n";
+    }
+}
+
+// ns-3 queue disc type of a --queueDisc name, empty for an unknown one
+static std::string
+QueueDiscType (const std::string &name)
+{
+  static const char *types[][2] = { { "fq_codel", "ns3::FqCoDelQueueDisc" }, { "codel", "ns3::CoDelQueueDisc" },
+                                    { "pie", "ns3::PieQueueDisc" }, { "red", "ns3::RedQueueDisc" },
+                                    { "pfifo_fast", "ns3::PfifoFastQueueDisc" } };
+  for (uint32_t i = 0; i < sizeof (types) / sizeof (types[0]); ++i)
+    {
+      if (name == types[i][0])
+        {
+          return types[i][1];
+        }
+    }
+  return "";
+}
+
+// ns-3 scheduler type of a --scheduler name, empty for an unknown one.
+// The calendar queue sizes its buckets from the spacing of sampled
+// events every time it resizes, so it tunes itself to the event mix.
+static std::string
+SchedulerType (const std::string &name)
+{
+  static const char *types[][2] = { { "map", "ns3::MapScheduler" }, { "heap", "ns3::HeapScheduler" },
+                                    { "list", "ns3::ListScheduler" }, { "calendar", "ns3::CalendarScheduler" },
+                                    { "priority", "ns3::PriorityQueueScheduler" } };
+  for (uint32_t i = 0; i < sizeof (types) / sizeof (types[0]); ++i)
+    {
+      if (name == types[i][0])
+        {
+          return types[i][1];
+        }
+    }
+  return "";
+}
+
+// machine readable summary of a profiled run, one JSON object; apps is
+// the number of senders created over all homes and epochs
+static void
+WriteProfile (const std::string &fileName, const ScenarioConfig &config, const ScenarioResult &result,
+              Ptr<ProfilingSimulatorImpl> profiler, double simulatedSeconds, uint32_t apps)
+{
+  std::ofstream out (fileName.c_str ());
+  out << "{\n"
+      << "  \"homes\": " << config.homes << ",\n"
+      << "  \"nWifi\": " << config.nWifi << ",\n"
+      << "  \"scheduler\": \"" << config.scheduler << "\",\n"
+      << "  \"protocol\": \"" << config.protocol << "\",\n"
+      << "  \"flows\": " << apps << ",\n"
+      << "  \"simulated_s\": " << simulatedSeconds << ",\n"
+      << "  \"wall_s\": " << result.wallSeconds << ",\n"
+      << "  \"sim_per_wall\": " << simulatedSeconds / result.wallSeconds << ",\n"
+      << "  \"events\": " << result.events << ",\n"
+      << "  \"events_per_s\": " << result.events / result.wallSeconds << ",\n"
+      << "  \"peak_rss_kb\": " << result.peakRssKb << ",\n"
+      << "  \"subsystems\": {";
+  for (uint32_t i = 0; i < ProfilingSimulatorImpl::N_SUBSYSTEMS; ++i)
+    {
+      out << (i ? "," : "") << "\n    \"" << ProfilingSimulatorImpl::GetSubsystemName (i) << "\": { \"events\": "
+          << profiler->GetEvents (i) << ", \"wall_s\": " << profiler->GetSeconds (i) << " }";
+    }
+  out << "\n  }\n}\n";
+}
+
+static ScenarioResult
+RunScenario (const ScenarioConfig &config)
+{
+  // The topology is built once for all traffic epochs: the first runs
+  // config.flows for simulationTime seconds and every later one starts
+  // epochGap seconds after the previous ended, with the stations still
+  // associated and the ARP caches and routes still in place.
+  std::vector<TrafficEpoch> epochs (1);
+  epochs[0].flows = config.flows;
+  epochs[0].duration = config.simulationTime;
+  epochs.insert (epochs.end (), config.epochs.begin (), config.epochs.end ());
+  std::vector<double> epochStart (1, 0.0);
+  for (uint32_t e = 1; e < epochs.size (); ++e)
+    {
+      epochStart.push_back (epochStart[e - 1] + epochs[e - 1].duration + config.epochGap);
+    }
+  double simulation_time = epochStart.back () + epochs.back ().duration;
+  // the implementation is created by the first Simulator call of the run
+  bool profiling = !config.profileFile.empty ();
+  GlobalValue::Bind ("SimulatorImplementationType",
+                     StringValue (config.distributed ? "ns3::DistributedSimulatorImpl"
+                                  : profiling ? "ns3::ProfilingSimulatorImpl" : "ns3::DefaultSimulatorImpl"));
+  GlobalValue::Bind ("SchedulerType", StringValue (SchedulerType (config.scheduler)));
+  // Distributed, every rank builds the whole topology but only runs the
+  // nodes with its own system id; the ISP link then becomes a remote
+  // channel whose delay is the lookahead between the ranks.
+  uint32_t rank = 0;
+  uint32_t ranks = 1;
+  uint32_t ispRank = config.distributed ? 1 : 0;
+#ifdef NS3_MPI
+  if (config.distributed)
+    {
+      rank = MpiInterface::GetSystemId ();
+      ranks = MpiInterface::GetSize ();
+    }
+#endif
+
+  // K homes of a router/AP, two PCs and nWifi STAs.  A single home is
+  // uplinked straight to the ISP server as in the original program;
+  // several homes are uplinked to an aggregation router that reaches the
+  // ISP server over the aggregation link.  Every phase below goes over
+  // all homes in the order the single home program created its objects,
+  // so one home still draws the same random numbers.
+  std::vector<Home> homes (config.homes);
+  NodeContainer isp; //ISP server, then the aggregation router if any
+  for (uint32_t k = 0; k < config.homes; ++k)
+    {
+      homes[k].wired.Create (3, HomeRank (k, ranks)); //router, PC1, PC2
+      if (k == 0)
+        {
+          isp.Create (config.homes > 1 ? 2 : 1, ispRank);
+        }
+      homes[k].stas.Create (config.nWifi, HomeRank (k, ranks));
+    }
+  Ptr<Node> uplinkPeer = isp.Get (config.homes > 1 ? 1 : 0);
+
+  PointToPointHelper pointToPoint; //point to point wired ethernet links of the homes and their uplinks
+  pointToPoint.SetDeviceAttribute ("DataRate", StringValue (config.linkRate));
+  pointToPoint.SetChannelAttribute ("Delay", StringValue (config.linkDelay));
+  for (uint32_t k = 0; k < config.homes; ++k)
+    {
+      Home &home = homes[k];
+      home.pc1Devices = pointToPoint.Install (home.wired.Get (0), home.wired.Get (1));
+      home.pc2Devices = pointToPoint.Install (home.wired.Get (0), home.wired.Get (2));
+      home.uplinkDevices = pointToPoint.Install (home.wired.Get (0), uplinkPeer);
+    }
+  NetDeviceContainer aggregationDevices; //aggregation router, ISP server
+  if (config.homes > 1)
+    {
+      PointToPointHelper aggregation;
+      aggregation.SetDeviceAttribute ("DataRate", StringValue (config.aggregationRate));
+      aggregation.SetChannelAttribute ("Delay", StringValue (config.aggregationDelay));
+      aggregationDevices = aggregation.Install (isp.Get (1), isp.Get (0));
+    }
+
+// configuring the WiFi channnel, one per home
+  YansWifiChannelHelper channel = YansWifiChannelHelper::Default ();
+  YansWifiPhyHelper phy;
+
+  WifiHelper wifi;
+  wifi.SetRemoteStationManager ("ns3::AarfWifiManager");
+
+  // one error rate table shared by the PHYs of every home, standing in
+  // for the YansWifiPhyHelper default model
+  Ptr<CachedErrorRateModel> errorTable;
+  if (config.errorTableStep > 0)
+    {
+      errorTable = CreateObject<CachedErrorRateModel> ();
+      errorTable->Setup (CreateObject<TableBasedErrorRateModel> (), config.errorTableStep, config.errorTableValidate);
+    }
+
+  WifiMacHelper mac;
+  for (uint32_t k = 0; k < config.homes; ++k)
+    {
+      Home &home = homes[k];
+      Ptr<YansWifiChannel> wifiChannel = channel.Create ();
+      if (config.rxCutoff < 0)
+        {
+          // the default channel's log distance loss, behind the cutoff
+          home.cutoff = CreateObject<CutoffPropagationLossModel> ();
+          home.cutoff->Setup (CreateObject<LogDistancePropagationLossModel> (), config.rxCutoff);
+          wifiChannel->SetPropagationLossModel (home.cutoff);
+        }
+      phy.SetChannel (wifiChannel);
+      std::ostringstream name;
+      name << "ns-3-ssid";
+      if (k > 0)
+        {
+          name << "-" << k;
+        }
+      Ssid ssid = Ssid (name.str ());
+      mac.SetType ("ns3::StaWifiMac",
+                   "Ssid", SsidValue (ssid),
+                   "ActiveProbing", BooleanValue (config.preAssociate));
+      home.staDevices = wifi.Install (phy, mac, home.stas);
+
+      mac.SetType ("ns3::ApWifiMac",
+                   "Ssid", SsidValue (ssid));
+      home.apDevices = wifi.Install (phy, mac, home.wired.Get (0)); //the wifi access point at the router itself
+
+      if (errorTable)
+        {
+          NetDeviceContainer bss (home.staDevices, home.apDevices);
+          for (uint32_t i = 0; i < bss.GetN (); ++i)
+            {
+              DynamicCast<WifiNetDevice> (bss.Get (i))->GetPhy ()->SetErrorRateModel (errorTable);
+            }
+        }
+    }
+
+  MobilityHelper mobility;
+  Rectangle walkBounds (-50, 50, -50, 50);
+  Ptr<BatchedWalkManager> walk; //moves the STAs of all homes at once
+  if (config.mobilityStep > 0)
+    {
+      walk = CreateObject<BatchedWalkManager> (walkBounds, Seconds (config.mobilityStep));
+    }
+
+  // the homes are on channels of their own, so they can all use the same
+  // coordinates
+  bool grid = config.placement == "grid" || (config.placement == "auto" && config.nWifi <= 18);
+  for (uint32_t k = 0; k < config.homes; ++k)
+    {
+      if (grid)
+        {
+          mobility.SetPositionAllocator ("ns3::GridPositionAllocator",
+                                         "MinX", DoubleValue (0.0),
+                                         "MinY", DoubleValue (0.0),
+                                         "DeltaX", DoubleValue (5.0),
+                                         "DeltaY", DoubleValue (10.0),
+                                         "GridWidth", UintegerValue (3),
+                                         "LayoutType", StringValue ("RowFirst"));
+        }
+      else
+        {
+          // uniform over a disc around the AP whose area grows with nWifi,
+          // about 80 m^2 per station as in the 5 station grid, until it
+          // touches the walk bounds
+          double rho = std::min (49.0, 5.0 * std::sqrt (static_cast<double> (config.nWifi)));
+          mobility.SetPositionAllocator ("ns3::UniformDiscPositionAllocator",
+                                         "rho", DoubleValue (rho),
+                                         "X", DoubleValue (0.0),
+                                         "Y", DoubleValue (0.0));
+        }
+
+      if (walk)
+        {
+          mobility.SetMobilityModel ("ns3::BatchedWalkMobilityModel");
+        }
+      else
+        {
+          mobility.SetMobilityModel ("ns3::RandomWalk2dMobilityModel",
+                                     "Bounds", RectangleValue (walkBounds));
+        }
+      mobility.Install (homes[k].stas);
+      if (walk)
+        {
+          for (uint32_t i = 0; i < config.nWifi; ++i)
+            {
+              walk->Add (homes[k].stas.Get (i)->GetObject<BatchedWalkMobilityModel> ());
+            }
+        }
+
+      if (!grid)
+        {
+          Ptr<ListPositionAllocator> apPosition = CreateObject<ListPositionAllocator> ();
+          apPosition->Add (Vector (0.0, 0.0, 0.0)); //AP at the centre of the disc
+          mobility.SetPositionAllocator (apPosition);
+        }
+      mobility.SetMobilityModel ("ns3::ConstantPositionMobilityModel");
+      mobility.Install (homes[k].wired.Get (0));
+
+      if (homes[k].cutoff)
+        {
+          for (uint32_t i = 0; i < config.nWifi; ++i)
+            {
+              homes[k].cutoff->Add (homes[k].stas.Get (i)->GetObject<MobilityModel> ());
+            }
+          homes[k].cutoff->Add (homes[k].wired.Get (0)->GetObject<MobilityModel> ());
+        }
+    }
+  if (walk)
+    {
+      walk->Start ();
+    }
+// installing the Internet stack to all the nodes to help TCP work
+  InternetStackHelper stack;
+  for (uint32_t k = 0; k < config.homes; ++k)
+    {
+      stack.Install (homes[k].wired.Get (0));
+      stack.Install (homes[k].stas);
+      stack.Install (homes[k].wired.Get (1));
+      stack.Install (homes[k].wired.Get (2));
+    }
+  stack.Install (isp);
+
+  // A queue disc on a router's uplink must be in place before the
+  // address assignment, which would install ns-3's default root queue
+  // disc, FqCoDel, on any device without one; runs without --queueDisc
+  // thus already have FqCoDel there, and the plain FIFO baseline is
+  // --queueDisc=pfifo_fast.  The device's own queue is cut to one packet
+  // so that the backlog builds up in the queue disc, where the AQM can
+  // act on it.
+  QueueMonitor *queueMonitor = 0;
+  if (!config.queueDisc.empty ())
+    {
+      TrafficControlHelper trafficControl;
+      trafficControl.SetRootQueueDisc (QueueDiscType (config.queueDisc));
+      if (!config.queueFile.empty ())
+        {
+          queueMonitor = new QueueMonitor (TaggedName (config.queueFile, config.runTag), Seconds (config.queueInterval));
+        }
+      for (uint32_t k = 0; k < config.homes; ++k)
+        {
+          Ptr<NetDevice> uplink = homes[k].uplinkDevices.Get (0);
+          DynamicCast<PointToPointNetDevice> (uplink)->GetQueue ()->SetMaxSize (QueueSize ("1p"));
+          QueueDiscContainer queues = trafficControl.Install (uplink);
+          if (queueMonitor && uplink->GetNode ()->GetSystemId () == rank)
+            {
+              queueMonitor->Add (queues.Get (0), k);
+            }
+        }
+    }
+
+  // Several homes are routed statically: global routing would give every
+  // node a route to every network, which does not scale to thousands of
+  // nodes, while here every home has a default route up to the
+  // aggregation router and that one a route down to each home network.
+  Ipv4AddressHelper address;
+  Ipv4Address ispAddress; //where the sinks listen
+  Ipv4InterfaceContainer aggregationInterfaces;
+  if (config.homes > 1)
+    {
+      address.SetBase ("10.0.0.0", "255.255.255.0");
+      aggregationInterfaces = address.Assign (aggregationDevices);
+      ispAddress = aggregationInterfaces.GetAddress (1);
+      AddStaticRoute (aggregationDevices.Get (1), Ipv4Address::GetAny (), Ipv4Mask::GetZero (),
+                      aggregationInterfaces.GetAddress (0));
+    }
+  for (uint32_t k = 0; k < config.homes; ++k)
+    {
+      Home &home = homes[k];
+      address.SetBase (HomeNetwork (k, 0), "255.255.255.0");
+      Ipv4InterfaceContainer pc1Interfaces = address.Assign (home.pc1Devices);
+
+      address.SetBase (HomeNetwork (k, 1), "255.255.255.0");
+      Ipv4InterfaceContainer pc2Interfaces = address.Assign (home.pc2Devices);
+
+      address.SetBase (HomeNetwork (k, 3), "255.255.255.0");
+      Ipv4InterfaceContainer uplinkInterfaces = address.Assign (home.uplinkDevices);
+
+      address.SetBase (HomeNetwork (k, 2), "255.255.255.0");
+      address.Assign (home.staDevices);
+      Ipv4InterfaceContainer apInterfaces = address.Assign (home.apDevices);
+
+      if (config.homes == 1)
+        {
+          ispAddress = uplinkInterfaces.GetAddress (1);
+          continue;
+        }
+      AddStaticRoute (home.pc1Devices.Get (1), Ipv4Address::GetAny (), Ipv4Mask::GetZero (), pc1Interfaces.GetAddress (0));
+      AddStaticRoute (home.pc2Devices.Get (1), Ipv4Address::GetAny (), Ipv4Mask::GetZero (), pc2Interfaces.GetAddress (0));
+      for (uint32_t i = 0; i < config.nWifi; ++i)
+        {
+          AddStaticRoute (home.staDevices.Get (i), Ipv4Address::GetAny (), Ipv4Mask::GetZero (), apInterfaces.GetAddress (0));
+        }
+      AddStaticRoute (home.uplinkDevices.Get (0), Ipv4Address::GetAny (), Ipv4Mask::GetZero (), uplinkInterfaces.GetAddress (1));
+      for (uint32_t j = 0; j < 3; ++j)
+        {
+          AddStaticRoute (home.uplinkDevices.Get (1), HomeNetwork (k, j), "255.255.255.0", uplinkInterfaces.GetAddress (0));
+        }
+    }
+
+  for (uint32_t k = 0; k < config.homes; ++k)
+    {
+      Ptr<RateErrorModel> em = CreateObject<RateErrorModel> (); //error model at the router
+      em->SetAttribute ("ErrorRate", DoubleValue (config.errorRate));
+      homes[k].pc1Devices.Get(0)->SetAttribute ("ReceiveErrorModel", PointerValue (em));
+
+      homes[k].senders.Add (homes[k].wired.Get (1)); //in the order used by SourceIndex
+      homes[k].senders.Add (homes[k].wired.Get (2));
+      homes[k].senders.Add (homes[k].stas);
+    }
+
+// one listening port per distinct port at the ISP node and one app per flow
+  TcpStateRecorder *tcpState = 0;
+  if (!config.tcpStateFile.empty ())
+    {
+      tcpState = new TcpStateRecorder (TaggedName (config.tcpStateFile, config.runTag));
+    }
+
+  // every home runs the whole flow table, home k on the ports of the
+  // table shifted by k times the span of its ports
+  std::vector<FlowSpec> allFlows = AllFlows (config);
+  uint32_t portSpan = PortSpan (allFlows);
+  std::set<uint16_t> ports; //listened on by the one sink at the ISP node
+  std::vector<std::map<uint16_t, double> > epochPorts (epochs.size ()); //active seconds per port
+  std::map<uint16_t, double> activeSeconds; //over all epochs
+  bool udp = config.protocol == "udp";
+  Ptr<MultiPortSink> sink = CreateObject<MultiPortSink> ();
+  sink->SetUdp (udp);
+  sink->SetLatency (!config.latencyFile.empty ());
+  sink->Setup (LowestPort (allFlows), config.homes * portSpan);
+  // the goodput is measured at the sink, so only on the ISP's rank
+  ThroughputMonitor *throughput = 0;
+  if (!config.throughputFile.empty () && ispRank == rank)
+    {
+      throughput = new ThroughputMonitor (TaggedName (config.throughputFile, config.runTag),
+                                          Seconds (config.throughputInterval), sink);
+    }
+  uint32_t flowId = 0;
+  for (uint32_t e = 0; e < epochs.size (); ++e)
+    {
+      const std::vector<FlowSpec> &flows = epochs[e].flows;
+      for (uint32_t k = 0; k < config.homes; ++k)
+        {
+          for (std::vector<FlowSpec>::const_iterator flow = flows.begin (); flow != flows.end (); ++flow, ++flowId)
+            {
+              uint16_t port = flow->port + k * portSpan;
+              Address sinkAddress (InetSocketAddress (ispAddress, port));
+              double stop = flow->stop > 0 ? flow->stop : epochs[e].duration;
+              epochPorts[e][port] = stop - flow->start;
+              activeSeconds[port] += stop - flow->start;
+              if (ispRank == rank && ports.insert (port).second)
+                {
+                  sink->AddPort (port);
+                  if (throughput)
+                    {
+                      throughput->AddPort (port);
+                    }
+                }
+
+              Ptr<Node> node = homes[k].senders.Get (SourceIndex (flow->source, config.nWifi));
+              if (node->GetSystemId () != rank)
+                {
+                  continue;
+                }
+              Ptr<Socket> senderSocket = Socket::CreateSocket (node, udp ? UdpSocketFactory::GetTypeId ()
+                                                                     : TcpSocketFactory::GetTypeId ());
+              if (tcpState)
+                {
+                  tcpState->Add (senderSocket, flowId);
+                }
+              Ptr<MyApp> app = CreateObject<MyApp> ();
+              app->Setup (senderSocket, sinkAddress, 1460, 1000000, flow->rate);
+              app->SetSequenceStamps (udp);
+              app->SetSendTimeTags (!udp && !config.latencyFile.empty ());
+              app->SetReusePayload (config.reusePayload);
+              app->SetSaturate (flow->saturate);
+              app->SetPacing (config.paceBurst, Seconds (config.paceInterval));
+              if (config.preAssociate && SourceIndex (flow->source, config.nWifi) >= 2)
+                {
+                  Ptr<NetDevice> device = homes[k].staDevices.Get (SourceIndex (flow->source, config.nWifi) - 2);
+                  app->SetAssociationMac (DynamicCast<StaWifiMac> (DynamicCast<WifiNetDevice> (device)->GetMac ()));
+                }
+              node->AddApplication (app);
+              app->SetStartTime (Seconds (epochStart[e] + flow->start));
+              app->SetStopTime (Seconds (epochStart[e] + stop));
+            }
+        }
+    }
+  std::vector<std::vector<uint64_t> > epochBytes; //sink counters at the end of every epoch's gap
+  for (uint32_t e = 1; ispRank == rank && e < epochs.size (); ++e)
+    {
+      Simulator::Schedule (Seconds (epochStart[e]), &RecordEpoch, sink, &epochBytes);
+    }
+  if (ispRank == rank)
+    {
+      isp.Get (0)->AddApplication (sink);
+      sink->SetStartTime (Seconds (0.));
+      sink->SetStopTime (Seconds (simulation_time));
+    }
+//populate routing tables
+  if (config.homes == 1)
+    {
+      Ipv4GlobalRoutingHelper::PopulateRoutingTables ();
+    }
+
+  Simulator::Stop (Seconds (simulation_time));
+// create pcap files
+  std::vector<PcapCapture *> captures;
+  if (config.tracing && config.capture == "all" && config.snapLen == 0)
+    {
+      phy.SetPcapDataLinkType (WifiPhyHelper::DLT_IEEE802_11_RADIO);
+      pointToPoint.EnablePcapAll (TaggedName ("p2p", config.runTag));
+      phy.EnablePcapAll (TaggedName ("Wifi", config.runTag));
+    }
+  else if (config.tracing)
+    {
+      // one "capture-<device>.pcap" per selected device, written by
+      // PcapCapture; the ISP link is traced at the ISP end.  The devices
+      // are those of the first home.
+      std::string list = config.capture;
+      if (list == "all")
+        {
+          std::ostringstream all;
+          all << "pc1,pc2,isp,ap";
+          for (uint32_t i = 0; i < config.nWifi; ++i)
+            {
+              all << ",sta" << i;
+            }
+          list = all.str ();
+        }
+      std::istringstream in (list);
+      std::string target;
+      while (std::getline (in, target, ','))
+        {
+          std::string fileName = TaggedName ("capture-" + target + ".pcap", config.runTag);
+          Ptr<NetDevice> device;
+          if (target == "ap" || target.compare (0, 3, "sta") == 0)
+            {
+              device = target == "ap" ? homes[0].apDevices.Get (0)
+                : homes[0].staDevices.Get (SourceIndex (target, config.nWifi) - 2);
+              Ptr<WifiPhy> wifiPhy = DynamicCast<WifiNetDevice> (device)->GetPhy ();
+              PcapCapture *capture = new PcapCapture (fileName, PcapHelper::DLT_IEEE802_11, config.snapLen, config.captureBlock);
+              wifiPhy->TraceConnectWithoutContext ("PhyTxBegin", MakeBoundCallback (&PcapCapture::SniffTx, capture));
+              wifiPhy->TraceConnectWithoutContext ("PhyRxEnd", MakeBoundCallback (&PcapCapture::Sniff, capture));
+              captures.push_back (capture);
+              continue;
+            }
+          device = target == "isp" ? (config.homes > 1 ? aggregationDevices.Get (1) : homes[0].uplinkDevices.Get (1))
+            : target == "pc1" ? homes[0].pc1Devices.Get (1) : homes[0].pc2Devices.Get (1);
+          PcapCapture *capture = new PcapCapture (fileName, PcapHelper::DLT_PPP, config.snapLen, config.captureBlock);
+          device->TraceConnectWithoutContext ("PromiscSniffer", MakeBoundCallback (&PcapCapture::Sniff, capture));
+          captures.push_back (capture);
+        }
+    }
+  if (throughput && throughput->GetNPorts () == 0)
+    {
+      delete throughput; //a flow table without flows
+      throughput = 0;
+    }
+  if (throughput)
+    {
+      throughput->Start (Seconds (simulation_time));
+    }
+  if (queueMonitor)
+    {
+      queueMonitor->Start (Seconds (simulation_time));
+    }
+  FlowMonitorHelper flowmon;
+  Ptr<FlowMonitor> monitor;
+  if (!config.flowStatsFile.empty ())
+    {
+      monitor = flowmon.Install (NodeContainer::GetGlobal ()); //routers, PCs, STAs and ISP
+    }
+// running the final simulator
+  std::chrono::steady_clock::time_point begin = std::chrono::steady_clock::now ();
+  Simulator::Run ();
+  ScenarioResult result;
+  result.activeSeconds = activeSeconds;
+  result.wallSeconds = std::chrono::duration<double> (std::chrono::steady_clock::now () - begin).count ();
+  result.events = Simulator::GetEventCount ();
+  struct rusage usage;
+  result.peakRssKb = getrusage (RUSAGE_SELF, &usage) == 0 ? usage.ru_maxrss : 0;
+  if (errorTable)
+    {
+      errorTable->Report (std::cout);
+    }
+  if (profiling)
+    {
+      Ptr<ProfilingSimulatorImpl> profiler = DynamicCast<ProfilingSimulatorImpl> (Simulator::GetImplementation ());
+      WriteProfile (TaggedName (config.profileFile, config.runTag), config, result, profiler, simulation_time, flowId);
+    }
+  if (throughput)
+    {
+      throughput->Finish (result.activeSeconds);
+      delete throughput;
+    }
+  if (queueMonitor)
+    {
+      queueMonitor->Finish ();
+      delete queueMonitor;
+    }
+  for (std::vector<PcapCapture *>::iterator capture = captures.begin (); capture != captures.end (); ++capture)
+    {
+      delete *capture;
+    }
+  delete tcpState;
+  if (monitor)
+    {
+      WriteFlowStats (TaggedName (config.flowStatsFile, config.runTag), monitor,
+                      DynamicCast<Ipv4FlowClassifier> (flowmon.GetClassifier ()), ports);
+    }
+  if (!config.udpStatsFile.empty () && ispRank == rank)
+    {
+      WriteDatagramStats (TaggedName (config.udpStatsFile, config.runTag), sink, ports);
+    }
+  for (std::set<uint16_t>::const_iterator port = ports.begin (); port != ports.end (); ++port)
+    {
+      result.rxBytes[*port] = sink->GetRxBytes ()[*port - sink->GetFirstPort ()];
+      if (!config.latencyFile.empty ())
+        {
+          result.latency[*port] = sink->GetLatency ()[*port - sink->GetFirstPort ()];
+        }
+    }
+  if (!config.latencyFile.empty () && ispRank == rank)
+    {
+      WriteLatency (TaggedName (config.latencyFile, config.runTag), result.latency);
+    }
+  if (!config.epochs.empty () && ispRank == rank)
+    {
+      RecordEpoch (sink, &epochBytes);
+      std::cout << "epoch,port,bytes,goodput_mbps" << std::endl;
+      for (uint32_t e = 0; e < epochs.size (); ++e)
+        {
+          for (std::map<uint16_t, double>::const_iterator port = epochPorts[e].begin (); port != epochPorts[e].end (); ++port)
+            {
+              uint32_t flow = port->first - sink->GetFirstPort ();
+              uint64_t bytes = epochBytes[e][flow] - (e > 0 ? epochBytes[e - 1][flow] : 0);
+              std::cout << e << "," << port->first << "," << bytes << ","
+                        << (port->second > 0 ? bytes * 8 / port->second / 1e6 : 0) << std::endl;
+            }
+        }
+    }
+  Simulator::Destroy ();
+  // lets a later run in this process assign the same networks again
+  Ipv4AddressGenerator::Reset ();
+  return result;
+}
+
+// results travel from a replication's process to the parent as text,
+// one "rx <port> <bytes> <active seconds>" line per sink, a "run <wall>
+// <events> <rss>" line and one "lat <port> <histogram>" line per
+// measured port
+static void
+WriteResult (std::ostream &out, const ScenarioResult &result)
+{
+  out << "run " << result.wallSeconds << " " << result.events << " " << result.peakRssKb << "\n";
+  for (std::map<uint16_t, uint64_t>::const_iterator rx = result.rxBytes.begin (); rx != result.rxBytes.end (); ++rx)
+    {
+      out << "rx " << rx->first << " " << rx->second << " " << result.activeSeconds.find (rx->first)->second << "\n";
+    }
+  for (std::map<uint16_t, LatencyHistogram>::const_iterator lat = result.latency.begin (); lat != result.latency.end (); ++lat)
+    {
+      out << "lat " << lat->first << " ";
+      lat->second.Write (out);
+      out << "\n";
+    }
+}
+
+static void
+ReadResult (std::istream &in, ScenarioResult &result)
+{
+  std::string key;
+  while (in >> key)
+    {
+      if (key == "rx")
+        {
+          uint32_t port;
+          uint64_t bytes;
+          double seconds;
+          in >> port >> bytes >> seconds;
+          result.rxBytes[port] = bytes;
+          result.activeSeconds[port] = seconds;
+        }
+      else if (key == "run")
+        {
+          in >> result.wallSeconds >> result.events >> result.peakRssKb;
+        }
+      else if (key == "lat")
+        {
+          uint32_t port;
+          in >> port;
+          result.latency[port].Read (in);
+        }
+    }
+}
+
+// Mbps a sink port received over the time its flows were sending
+static double
+Goodput (const ScenarioResult &result, uint16_t port)
+{
+  double seconds = result.activeSeconds.find (port)->second;
+  return seconds > 0 ? result.rxBytes.find (port)->second * 8 / seconds / 1e6 : 0;
+}
+
+// two-sided 95% Student t quantile for the given degrees of freedom
+static double
+StudentT95 (uint32_t df)
+{
+  static const double t[] = { 0, 12.706, 4.303, 3.182, 2.776, 2.571, 2.447, 2.365, 2.306, 2.262, 2.228,
+                              2.201, 2.179, 2.160, 2.145, 2.131, 2.120, 2.110, 2.101, 2.093, 2.086,
+                              2.080, 2.074, 2.069, 2.064, 2.060, 2.056, 2.052, 2.048, 2.045, 2.042 };
+  return df <= 30 ? t[df] : 1.960;
+}
+
+// Runs configs[i] with RngRun runs[i] in its own forked process, up to
+// jobs processes at a time.  Every child returns its ScenarioResult
+// through a pipe; ok[i] tells whether results[i] was filled in.  A child
+// starts with the parent's small footprint, so its peak RSS is the run's.
+static bool
+RunForked (const std::vector<ScenarioConfig> &configs, const std::vector<uint32_t> &runs, uint32_t jobs,
+           std::vector<ScenarioResult> &results, std::vector<bool> &ok)
+{
+  struct Child
+  {
+    pid_t pid;
+    int fd;
+    uint32_t index;
+    std::string output;
+  };
+  std::vector<Child> active;
+  results.assign (configs.size (), ScenarioResult ());
+  ok.assign (configs.size (), false);
+  uint32_t next = 0;
+  while (next < configs.size () || !active.empty ())
+    {
+      while (next < configs.size () && active.size () < jobs)
+        {
+          int fds[2];
+          if (pipe (fds) != 0)
+            {
+              perror ("pipe");
+              return false;
+            }
+          uint32_t index = next++;
+          std::cout.flush (); //or the child repeats whatever is buffered
+          pid_t pid = fork ();
+          if (pid < 0)
+            {
+              perror ("fork");
+              return false;
+            }
+          if (pid == 0)
+            {
+              close (fds[0]);
+              RngSeedManager::SetRun (runs[index]);
+              std::ostringstream out;
+              WriteResult (out, RunScenario (configs[index]));
+              std::string text = out.str ();
+              for (std::string::size_type done = 0; done < text.size (); )
+                {
+                  ssize_t n = write (fds[1], text.data () + done, text.size () - done);
+                  if (n < 0 && errno != EINTR)
+                    {
+                      _exit (1);
+                    }
+                  done += n > 0 ? n : 0;
+                }
+              std::cout.flush ();
+              fflush (stdout);
+              _exit (0);
+            }
+          close (fds[1]);
+          Child child;
+          child.pid = pid;
+          child.fd = fds[0];
+          child.index = index;
+          active.push_back (child);
+        }
+
+      std::vector<struct pollfd> pfds (active.size ());
+      for (uint32_t i = 0; i < active.size (); ++i)
+        {
+          pfds[i].fd = active[i].fd;
+          pfds[i].events = POLLIN;
+          pfds[i].revents = 0;
+        }
+      if (poll (&pfds[0], pfds.size (), -1) < 0)
+        {
+          if (errno == EINTR)
+            {
+              continue;
+            }
+          perror ("poll");
+          return false;
+        }
+      for (uint32_t i = active.size (); i-- > 0; )
+        {
+          if (pfds[i].revents == 0)
+            {
+              continue;
+            }
+          char buffer[4096];
+          ssize_t n = read (active[i].fd, buffer, sizeof (buffer));
+          if (n > 0 || (n < 0 && errno == EINTR))
+            {
+              active[i].output.append (buffer, n > 0 ? n : 0);
+              continue;
+            }
+          close (active[i].fd);
+          int status = 0;
+          waitpid (active[i].pid, &status, 0);
+          uint32_t index = active[i].index;
+          if (WIFEXITED (status) && WEXITSTATUS (status) == 0)
+            {
+              std::istringstream in (active[i].output);
+              ReadResult (in, results[index]);
+              ok[index] = true;
+            }
+          else
+            {
+              std::cout << "run " << configs[index].runTag << " (RngRun " << runs[index] << ") failed" << std::endl;
+            }
+          active.erase (active.begin () + i);
+        }
+    }
+  return true;
+}
+
+// Runs the scenario with RngRun firstRun, firstRun+1, ... in up to jobs
+// processes at a time and writes the mean goodput of each port with its
+// 95% confidence interval to summaryFile.
+static int
+RunReplications (const ScenarioConfig &config, uint32_t replications, uint32_t firstRun, uint32_t jobs,
+                 const std::string &summaryFile)
+{
+  std::vector<ScenarioConfig> configs (replications, config);
+  std::vector<uint32_t> runs (replications);
+  for (uint32_t i = 0; i < replications; ++i)
+    {
+      runs[i] = firstRun + i;
+      std::ostringstream tag;
+      tag << "run" << runs[i];
+      configs[i].runTag = tag.str ();
+    }
+  std::vector<ScenarioResult> results;
+  std::vector<bool> ok;
+  if (!RunForked (configs, runs, jobs, results, ok))
+    {
+      return 1;
+    }
+
+  bool failed = false;
+  std::map<uint16_t, std::vector<double> > goodput; //Mbps of every replication per port
+  std::map<uint16_t, LatencyHistogram> latency;     //of all replications together
+  for (uint32_t i = 0; i < results.size (); ++i)
+    {
+      if (!ok[i])
+        {
+          failed = true;
+          continue;
+        }
+      for (std::map<uint16_t, uint64_t>::const_iterator rx = results[i].rxBytes.begin (); rx != results[i].rxBytes.end (); ++rx)
+        {
+          goodput[rx->first].push_back (Goodput (results[i], rx->first));
+        }
+      for (std::map<uint16_t, LatencyHistogram>::const_iterator lat = results[i].latency.begin ();
+           lat != results[i].latency.end (); ++lat)
+        {
+          latency[lat->first].Merge (lat->second);
+        }
+    }
+  if (!config.latencyFile.empty ())
+    {
+      WriteLatency (config.latencyFile, latency);
+    }
+  std::ofstream summary (summaryFile.c_str ());
+  summary << "port,replications,mean_mbps,stddev_mbps,ci95_low_mbps,ci95_high_mbps\n";
+  for (std::map<uint16_t, std::vector<double> >::const_iterator port = goodput.begin (); port != goodput.end (); ++port)
+    {
+      const std::vector<double> &x = port->second;
+      double mean = 0;
+      for (uint32_t i = 0; i < x.size (); ++i)
+        {
+          mean += x[i] / x.size ();
+        }
+      double variance = 0;
+      for (uint32_t i = 0; i < x.size (); ++i)
+        {
+          variance += (x[i] - mean) * (x[i] - mean) / (x.size () > 1 ? x.size () - 1 : 1);
+        }
+      double stddev = std::sqrt (variance);
+      double halfWidth = x.size () > 1 ? StudentT95 (x.size () - 1) * stddev / std::sqrt (x.size ()) : 0;
+      summary << port->first << "," << x.size () << "," << mean << "," << stddev << ","
+              << mean - halfWidth << "," << mean + halfWidth << "\n";
+      std::cout << "port " << port->first << ": " << mean << " +/- " << halfWidth << " Mbps over "
+                << x.size () << " replications" << std::endl;
+    }
+  return failed ? 1 : 0;
+}
+
+struct FlowOptions //where the flow table comes from
+{
+  uint32_t scenario;
+  std::string flows;
+  std::string flowFile;
+  std::string appRate; //rate of flows that do not give one
+  bool saturate;
+  double defaultStart; //of flows that do not give one, negative for automatic
+};
+
+// fills config.flows from --flowFile and --flows, or from the preset
+// scenario when neither is given
+static bool
+BuildFlowTable (const FlowOptions &options, ScenarioConfig &config)
+{
+  config.flows.clear ();
+  if (!options.flowFile.empty () && !ReadFlowFile (options.flowFile, options.appRate, config.flows))
+    {
+      return false;
+    }
+  if (!options.flows.empty () && !ParseFlowList (options.flows, options.appRate, config.flows))
+    {
+      return false;
+    }
+  if (options.flowFile.empty () && options.flows.empty ())
+    {
+      if (options.scenario < 1 || options.scenario > 4)
+        {
+          std::cout << "scenario should be 1, 2, 3 or 4" << std::endl;
+          return false;
+        }
+      FlowSpec probe;
+      if (!ParseRate (options.appRate, probe))
+        {
+          std::cout << "bad appRate \"" << options.appRate << "\"" << std::endl;
+          return false;
+        }
+      config.flows = ScenarioFlows (options.scenario, config.nWifi, options.appRate);
+    }
+  // flows wait for the stations to associate unless they are
+  // pre-associated
+  double defaultStart = options.defaultStart >= 0 ? options.defaultStart : config.preAssociate ? 0.0 : 1.0;
+  for (std::vector<FlowSpec>::iterator flow = config.flows.begin (); flow != config.flows.end (); ++flow)
+    {
+      flow->saturate = flow->saturate || options.saturate;
+      flow->start = flow->start < 0 ? defaultStart : flow->start;
+    }
+  return true;
+}
+
+static bool
+CheckConfig (const ScenarioConfig &config)
+{
+  if (config.placement != "auto" && config.placement != "grid" && config.placement != "disc")
+    {
+      std::cout << "placement should be auto, grid or disc" << std::endl;
+      return false;
+    }
+  // The underlying restriction of 18 is due to the grid position
+  // allocator's configuration; the grid layout will exceed the
+  // bounding box if more than 18 nodes are provided.
+  if (config.placement == "grid" && config.nWifi > 18)
+    {
+      std::cout << "nWifi should be 18 or less; otherwise grid layout exceeds the bounding box" << std::endl;
+      return false;
+    }
+  if (config.nWifi > 253)
+    {
+      std::cout << "nWifi should be 253 or less, the BSS is one /24 network" << std::endl;
+      return false;
+    }
+  if (config.homes < 1 || config.homes > 63 * 254)
+    {
+      std::cout << "homes should be between 1 and " << 63 * 254 << std::endl;
+      return false;
+    }
+  for (uint32_t e = 0; e <= config.epochs.size (); ++e)
+    {
+      const std::vector<FlowSpec> &table = e == 0 ? config.flows : config.epochs[e - 1].flows;
+      double duration = e == 0 ? config.simulationTime : config.epochs[e - 1].duration;
+      std::set<uint16_t> tablePorts;
+      for (std::vector<FlowSpec>::const_iterator flow = table.begin (); flow != table.end (); ++flow)
+        {
+          double stop = flow->stop > 0 ? flow->stop : duration;
+          if (flow->start < 0 || flow->start >= stop || stop > duration)
+            {
+              std::cout << "flow on port " << flow->port << " should start at or after 0 and stop after its start and by "
+                        << duration << "s" << std::endl;
+              return false;
+            }
+          if (!tablePorts.insert (flow->port).second)
+            {
+              std::cout << "port " << flow->port << " is used by two flows of one flow table" << std::endl;
+              return false;
+            }
+        }
+    }
+  std::vector<FlowSpec> flows = AllFlows (config);
+  uint32_t highestPort = 0;
+  for (std::vector<FlowSpec>::const_iterator flow = flows.begin (); flow != flows.end (); ++flow)
+    {
+      highestPort = std::max<uint32_t> (highestPort, flow->port + (config.homes - 1) * PortSpan (flows));
+    }
+  if (highestPort > 65535)
+    {
+      std::cout << "the flow ports of " << config.homes << " homes run past 65535" << std::endl;
+      return false;
+    }
+  std::istringstream captureList (config.capture);
+  std::string target;
+  while (config.capture != "all" && std::getline (captureList, target, ','))
+    {
+      if (target != "isp" && target != "ap" && SourceIndex (target, config.nWifi) < 0)
+        {
+          std::cout << "unknown capture device " << target << " (all, pc1, pc2, isp, ap or staN)" << std::endl;
+          return false;
+        }
+    }
+  if (config.rxCutoff > 0)
+    {
+      std::cout << "rxCutoff is a negative power in dBm, or 0 for none" << std::endl;
+      return false;
+    }
+  if (config.protocol != "tcp" && config.protocol != "udp")
+    {
+      std::cout << "protocol should be tcp or udp" << std::endl;
+      return false;
+    }
+  for (std::vector<FlowSpec>::const_iterator flow = flows.begin (); config.protocol == "udp" && flow != flows.end (); ++flow)
+    {
+      if (flow->saturate)
+        {
+          std::cout << "a UDP flow cannot fill a socket buffer; saturate it with a rate above the link's instead of max" << std::endl;
+          return false;
+        }
+    }
+  if (config.protocol == "udp" && !config.tcpStateFile.empty ())
+    {
+      std::cout << "tcpStateFile needs TCP flows" << std::endl;
+      return false;
+    }
+  if (config.protocol != "udp" && !config.udpStatsFile.empty ())
+    {
+      std::cout << "udpStatsFile needs --protocol=udp" << std::endl;
+      return false;
+    }
+  if (!config.queueDisc.empty () && QueueDiscType (config.queueDisc).empty ())
+    {
+      std::cout << "queueDisc should be fq_codel, codel, pie, red or pfifo_fast" << std::endl;
+      return false;
+    }
+  if (!config.queueFile.empty () && (config.queueDisc.empty () || config.queueInterval <= 0))
+    {
+      std::cout << "queueFile needs a queueDisc and a positive queueInterval" << std::endl;
+      return false;
+    }
+  if (SchedulerType (config.scheduler).empty ())
+    {
+      std::cout << "scheduler should be map, heap, list, calendar or priority" << std::endl;
+      return false;
+    }
+  if (config.paceBurst > 10000)
+    {
+      std::cout << "paceBurst should be at most 10000 packets" << std::endl;
+      return false;
+    }
+  if (config.paceInterval < 0 || config.paceInterval > 1)
+    {
+      std::cout << "paceInterval should be between 0 and 1 second" << std::endl;
+      return false;
+    }
+  // MyApp keeps its pacing credit in bit-nanoseconds in a uint64_t, with
+  // room for one interval's credit on top of what is left over
+  for (std::vector<FlowSpec>::const_iterator flow = flows.begin (); config.paceInterval > 0 && flow != flows.end (); ++flow)
+    {
+      if (!flow->saturate && flow->rate.GetBitRate () * config.paceInterval * 1e9 > std::numeric_limits<uint64_t>::max () / 2.0)
+        {
+          std::cout << "paceInterval " << config.paceInterval << "s is too long for the rate of the flow on port "
+                    << flow->port << std::endl;
+          return false;
+        }
+    }
+  if (config.mobilityStep < 0)
+    {
+      std::cout << "mobilityStep should not be negative" << std::endl;
+      return false;
+    }
+  if (config.errorTableStep < 0)
+    {
+      std::cout << "errorTable should be a positive SNR step in dB, or 0 for the exact model" << std::endl;
+      return false;
+    }
+  if (config.epochGap < 0)
+    {
+      std::cout << "epochGap should not be negative" << std::endl;
+      return false;
+    }
+  if (config.distributed && !config.profileFile.empty ())
+    {
+      std::cout << "profileFile needs the default simulator, not the distributed one" << std::endl;
+      return false;
+    }
+  if (config.distributed && !config.flowStatsFile.empty ())
+    {
+      std::cout << "flowStatsFile needs both ends of every flow in one process, not a distributed run" << std::endl;
+      return false;
+    }
+  if (config.distributed && !Time (config.linkDelay).IsStrictlyPositive ())
+    {
+      std::cout << "a distributed run needs a nonzero linkDelay as lookahead" << std::endl;
+      return false;
+    }
+  for (std::vector<FlowSpec>::const_iterator flow = flows.begin (); flow != flows.end (); ++flow)
+    {
+      if (SourceIndex (flow->source, config.nWifi) < 0)
+        {
+          std::cout << "unknown flow source " << flow->source << " (pc1, pc2 or sta0..sta"
+                    << config.nWifi - 1 << ")" << std::endl;
+          return false;
+        }
+    }
+  return true;
+}
+
+// Runs the scenario once per station count, back to back in this
+// process, and prints the wall time of each run as CSV.
+static int
+RunScalingSweep (ScenarioConfig config, const FlowOptions &options, const std::string &sweep)
+{
+  std::cout << "nWifi,wall_s,sim_s_per_wall_s" << std::endl;
+  std::istringstream in (sweep);
+  std::string item;
+  while (std::getline (in, item, ','))
+    {
+      config.nWifi = std::atoi (item.c_str ());
+      if (!BuildFlowTable (options, config) || !CheckConfig (config))
+        {
+          return 1;
+        }
+      std::chrono::steady_clock::time_point begin = std::chrono::steady_clock::now ();
+      RunScenario (config);
+      double wall = std::chrono::duration<double> (std::chrono::steady_clock::now () - begin).count ();
+      std::cout << config.nWifi << "," << wall << "," << config.simulationTime / wall << std::endl;
+    }
+  return 0;
+}
+
+struct BenchmarkCase //one row of a benchmark or baseline file
+{
+  std::string name;
+  double wallSeconds;
+  uint64_t events;
+  double eventsPerSecond;
+  long peakRssKb;
+};
+
+// reads the file --benchmark wrote, keyed by case name
+static bool
+ReadBenchmark (const std::string &fileName, std::map<std::string, BenchmarkCase> &cases)
+{
+  std::ifstream in (fileName.c_str ());
+  if (!in)
+    {
+      std::cout << "cannot open baseline file " << fileName << std::endl;
+      return false;
+    }
+  std::string line;
+  std::getline (in, line); //header
+  while (std::getline (in, line))
+    {
+      for (std::string::size_type i = 0; i < line.size (); ++i)
+        {
+          line[i] = line[i] == ',' ? ' ' : line[i];
+        }
+      std::istringstream fields (line);
+      BenchmarkCase c;
+      if (fields >> c.name >> c.wallSeconds >> c.events >> c.eventsPerSecond >> c.peakRssKb)
+        {
+          cases[c.name] = c;
+        }
+    }
+  return true;
+}
+
+// Times scenarios 1-4 with each of the comma separated station counts,
+// with tracing off and on, every case in its own process one after the
+// other so the timings do not compete and the peak RSS is the case's own.
+// The results go to outputFile and, given a baseline written the same
+// way, a case regresses when its events/s drop or its wall time or peak
+// RSS grow by more than tolerance (a fraction); the return value is then
+// nonzero.  A changed event count means the model changed rather than
+// the simulator and is only reported.  Given a comma separated list of
+// schedulers, every case is run with each of them and their name is
+// appended to the case's.
+static int
+RunBenchmark (ScenarioConfig config, FlowOptions options, const std::string &sizes, const std::string &schedulers,
+              const std::string &outputFile, const std::string &baselineFile, double tolerance)
+{
+  std::map<std::string, BenchmarkCase> baseline;
+  if (!baselineFile.empty () && !ReadBenchmark (baselineFile, baseline))
+    {
+      return 1;
+    }
+  std::vector<ScenarioConfig> configs;
+  std::vector<uint32_t> runs;
+  for (uint32_t tracing = 0; tracing <= 1; ++tracing)
+    {
+      for (options.scenario = 1; options.scenario <= 4; ++options.scenario)
+        {
+          std::istringstream in (sizes);
+          std::string item;
+          while (std::getline (in, item, ','))
+            {
+              config.nWifi = std::atoi (item.c_str ());
+              config.tracing = tracing;
+              std::istringstream schedulerList (schedulers.empty () ? config.scheduler : schedulers);
+              while (std::getline (schedulerList, config.scheduler, ','))
+                {
+                  if (!BuildFlowTable (options, config) || !CheckConfig (config))
+                    {
+                      return 1;
+                    }
+                  std::ostringstream name;
+                  name << "s" << options.scenario << "-n" << config.nWifi << (tracing ? "-trace" : "-notrace");
+                  if (!schedulers.empty ())
+                    {
+                      name << "-" << config.scheduler;
+                    }
+                  config.runTag = name.str ();
+                  configs.push_back (config);
+                  runs.push_back (RngSeedManager::GetRun ());
+                }
+            }
+        }
+    }
+  std::vector<ScenarioResult> results;
+  std::vector<bool> ok;
+  if (!RunForked (configs, runs, 1, results, ok))
+    {
+      return 1;
+    }
+
+  bool failed = false;
+  std::ofstream out (outputFile.c_str ());
+  out << "case,wall_s,events,events_per_s,peak_rss_kb\n";
+  for (uint32_t i = 0; i < configs.size (); ++i)
+    {
+      if (!ok[i])
+        {
+          failed = true;
+          continue;
+        }
+      BenchmarkCase c;
+      c.name = configs[i].runTag;
+      c.wallSeconds = results[i].wallSeconds;
+      c.events = results[i].events;
+      c.eventsPerSecond = c.events / c.wallSeconds;
+      c.peakRssKb = results[i].peakRssKb;
+      out << c.name << "," << c.wallSeconds << "," << c.events << "," << c.eventsPerSecond << ","
+          << c.peakRssKb << "\n";
+      std::cout << c.name << ": " << c.wallSeconds << " s, " << c.eventsPerSecond << " events/s, "
+                << c.peakRssKb << " kB";
+      std::map<std::string, BenchmarkCase>::const_iterator base = baseline.find (c.name);
+      if (base != baseline.end ())
+        {
+          const BenchmarkCase &b = base->second;
+          if (c.eventsPerSecond < b.eventsPerSecond * (1 - tolerance))
+            {
+              std::cout << ", REGRESSION events/s was " << b.eventsPerSecond;
+              failed = true;
+            }
+          if (c.wallSeconds > b.wallSeconds * (1 + tolerance))
+            {
+              std::cout << ", REGRESSION wall time was " << b.wallSeconds;
+              failed = true;
+            }
+          if (c.peakRssKb > b.peakRssKb * (1 + tolerance))
+            {
+              std::cout << ", REGRESSION peak RSS was " << b.peakRssKb;
+              failed = true;
+            }
+          if (c.events != b.events)
+            {
+              std::cout << ", event count changed from " << b.events;
+            }
+        }
+      else if (!baseline.empty ())
+        {
+          std::cout << ", not in baseline";
+        }
+      std::cout << std::endl;
+    }
+  return failed ? 1 : 0;
+}
+
+// the options that describe one run; main and every --batchFile line
+// parse them
+static void
+AddScenarioOptions (CommandLine &cmd, ScenarioConfig &config, FlowOptions &options)
+{
+  cmd.AddValue ("nWifi", "Number of wifi STA devices", config.nWifi);
+  cmd.AddValue ("homes", "Number of homes sharing the ISP server", config.homes);
+  cmd.AddValue ("aggregationRate", "Data rate from the homes' aggregation router to the ISP (homes > 1)", config.aggregationRate);
+  cmd.AddValue ("aggregationDelay", "Delay from the homes' aggregation router to the ISP (homes > 1)", config.aggregationDelay);
+  cmd.AddValue ("placement", "STA layout: grid (at most 18), disc or auto", config.placement);
+  cmd.AddValue ("simulationTime", "Simulated seconds", config.simulationTime);
+  cmd.AddValue ("errorRate", "Receive error rate at the router's PC1 device", config.errorRate);
+  cmd.AddValue ("linkRate", "Data rate of the point-to-point links", config.linkRate);
+  cmd.AddValue ("linkDelay", "Delay of the point-to-point links", config.linkDelay);
+  cmd.AddValue ("tracing", "Enable pcap tracing", config.tracing);
+  cmd.AddValue ("capture", "Devices to trace: all, or a list of pc1, pc2, isp, ap, staN", config.capture);
+  cmd.AddValue ("snapLen", "Bytes kept per traced frame, 0 for whole frames", config.snapLen);
+  cmd.AddValue ("captureBlock", "Bytes buffered per trace file between writes", config.captureBlock);
+  cmd.AddValue ("throughputFile", "Write windowed per-port goodput to this CSV file", config.throughputFile);
+  cmd.AddValue ("throughputInterval", "Goodput window in seconds", config.throughputInterval);
+  cmd.AddValue ("tcpStateFile", "Record cwnd, ssthresh, RTT and bytes in flight of every flow to this binary file", config.tcpStateFile);
+  cmd.AddValue ("flowStatsFile", "Write FlowMonitor delay, jitter, loss and throughput per flow to this CSV file", config.flowStatsFile);
+  cmd.AddValue ("protocol", "Transport of every flow: tcp, or udp with sequence and send time stamps", config.protocol);
+  cmd.AddValue ("queueDisc", "Queue disc on the routers' uplinks: fq_codel, codel, pie, red or pfifo_fast (FIFO baseline); ns-3 defaults to fq_codel", config.queueDisc);
+  cmd.AddValue ("queueFile", "Write the uplink queue discs' backlog, sojourn time and drops to this CSV file", config.queueFile);
+  cmd.AddValue ("queueInterval", "Seconds between uplink queue samples", config.queueInterval);
+  cmd.AddValue ("latencyFile", "Write p50/p99/p99.9 one-way packet delay of every flow to this CSV file (merged over replications)", config.latencyFile);
+  cmd.AddValue ("udpStatsFile", "Write loss, reordering and one-way delay percentiles of every UDP flow to this CSV file", config.udpStatsFile);
+  cmd.AddValue ("profileFile", "Write wall time, events/s, peak RSS and per-subsystem handler time as JSON", config.profileFile);
+  cmd.AddValue ("reusePayload", "Send copy-on-write copies of one payload packet", config.reusePayload);
+  cmd.AddValue ("paceBurst", "Packets a paced flow sends per timer event, 0 for one event per packet", config.paceBurst);
+  cmd.AddValue ("paceInterval", "Seconds between a paced flow's timer events (instead of paceBurst), 0 for none", config.paceInterval);
+  cmd.AddValue ("appRate", "MyApp rate of flows that do not give one", options.appRate);
+  cmd.AddValue ("saturate", "Make every flow a saturated sender (same as rate max)", options.saturate);
+  cmd.AddValue ("flowStart", "Start time of flows that do not give one, negative for 1s (0s with preAssociate)", options.defaultStart);
+  cmd.AddValue ("rxCutoff", "Receive power (dBm) below which a PHY does not hear a transmission at all, 0 for none", config.rxCutoff);
+  cmd.AddValue ("scheduler", "Event scheduler: map, heap, list, calendar or priority", config.scheduler);
+  cmd.AddValue ("mobilityStep", "Move all STAs together every this many seconds, 0 for a RandomWalk2d model each", config.mobilityStep);
+  cmd.AddValue ("errorTable", "SNR step (dB) of a WiFi error rate lookup table, 0 for the exact model", config.errorTableStep);
+  cmd.AddValue ("errorTableValidate", "Report how far the error rate table is from the exact model", config.errorTableValidate);
+  cmd.AddValue ("preAssociate", "Associate the STAs by active probing at once and start their flows on association", config.preAssociate);
+  cmd.AddValue ("scenario", "Preset flow table 1..4 (the former wn_a2_p1..p4)", options.scenario);
+  cmd.AddValue ("flows", "Comma separated flows source:port[:rate[:start[:stop]]]", options.flows);
+  cmd.AddValue ("flowFile", "File with one flow per line, overrides --scenario", options.flowFile);
+}
+
+// Parses one line of dash-less options, e.g. "appRate=50Mbps scenario=2",
+// with cmd ('#' starts a comment).  False for a line without options.
+static bool
+ParseOptionLine (const std::string &line, CommandLine &cmd)
+{
+  std::istringstream words (line.substr (0, line.find ('#')));
+  std::vector<std::string> args (1, "wn_a2_scenario");
+  std::string word;
+  while (words >> word)
+    {
+      args.push_back ("--" + word);
+    }
+  if (args.size () == 1)
+    {
+      return false;
+    }
+  std::vector<char *> argv;
+  for (uint32_t i = 0; i < args.size (); ++i)
+    {
+      argv.push_back (&args[i][0]);
+    }
+  cmd.Parse (argv.size (), &argv[0]);
+  return true;
+}
+
+// Reads the traffic epochs run after the first one on the same topology
+// (see RunScenario), one per line as traffic options on top of the
+// command line:
+//
+//   scenario=2 duration=10
+//   flows=pc1:8080:50Mbps,sta0:8081:20Mbps appRate=10Mbps
+//
+// duration defaults to --simulationTime.
+static bool
+ReadEpochFile (const std::string &epochFile, const FlowOptions &baseOptions, ScenarioConfig &config)
+{
+  std::ifstream in (epochFile.c_str ());
+  if (!in)
+    {
+      std::cout << "cannot open epoch file " << epochFile << std::endl;
+      return false;
+    }
+  std::string line;
+  uint32_t lineNumber = 0;
+  while (std::getline (in, line))
+    {
+      ++lineNumber;
+      FlowOptions options = baseOptions;
+      TrafficEpoch epoch;
+      epoch.duration = config.simulationTime;
+      CommandLine cmd;
+      cmd.AddValue ("appRate", "MyApp rate of flows that do not give one", options.appRate);
+      cmd.AddValue ("saturate", "Make every flow a saturated sender", options.saturate);
+      cmd.AddValue ("scenario", "Preset flow table 1..4", options.scenario);
+      cmd.AddValue ("flows", "Comma separated flows source:port[:rate[:start[:stop]]]", options.flows);
+      cmd.AddValue ("flowFile", "File with one flow per line", options.flowFile);
+      cmd.AddValue ("duration", "Simulated seconds of the epoch", epoch.duration);
+      if (!ParseOptionLine (line, cmd))
+        {
+          continue;
+        }
+      ScenarioConfig epochConfig = config;
+      if (!BuildFlowTable (options, epochConfig) || epoch.duration <= 0)
+        {
+          std::cout << epochFile << ":" << lineNumber << ": invalid epoch" << std::endl;
+          return false;
+        }
+      epoch.flows = epochConfig.flows;
+      config.epochs.push_back (epoch);
+    }
+  return true;
+}
+
+// Every global value (RngRun, SchedulerType, ...) and attribute default
+// as they are at one point, so that the options of one batch line can be
+// undone before the next
+struct GlobalDefaults
+{
+  std::vector<std::pair<GlobalValue *, std::string> > globals;
+  std::vector<std::pair<TypeId, std::vector<Ptr<const AttributeValue> > > > attributes; //initial values per type
+};
+
+static GlobalDefaults
+SaveDefaults (void)
+{
+  GlobalDefaults defaults;
+  for (GlobalValue::Iterator global = GlobalValue::Begin (); global != GlobalValue::End (); ++global)
+    {
+      StringValue value;
+      (*global)->GetValue (value);
+      defaults.globals.push_back (std::make_pair (*global, value.Get ()));
+    }
+  for (uint16_t i = 0; i < TypeId::GetRegisteredN (); ++i)
+    {
+      TypeId tid = TypeId::GetRegistered (i);
+      std::vector<Ptr<const AttributeValue> > values;
+      for (std::size_t j = 0; j < tid.GetAttributeN (); ++j)
+        {
+          values.push_back (tid.GetAttribute (j).initialValue);
+        }
+      defaults.attributes.push_back (std::make_pair (tid, values));
+    }
+  return defaults;
+}
+
+static void
+RestoreDefaults (const GlobalDefaults &defaults)
+{
+  for (uint32_t i = 0; i < defaults.globals.size (); ++i)
+    {
+      defaults.globals[i].first->SetValue (StringValue (defaults.globals[i].second));
+    }
+  for (uint32_t i = 0; i < defaults.attributes.size (); ++i)
+    {
+      TypeId tid = defaults.attributes[i].first;
+      for (std::size_t j = 0; j < defaults.attributes[i].second.size (); ++j)
+        {
+          tid.SetAttributeInitialValue (j, defaults.attributes[i].second[j]);
+        }
+    }
+}
+
+// Runs one scenario per line of batchFile, back to back in this process
+// so ns-3 is loaded and initialised once.  A line is a list of options
+// without their dashes, e.g.
+//
+//   simulationTime=10 errorRate=0.0001 linkRate=10Mbps appRate=50Mbps
+//
+// applied on top of the command line ('#' starts a comment); RngRun,
+// other global values and --ns3::Type::Attribute defaults may be given
+// too and only last for their line.
+// The goodput of every port is printed as CSV.  Runs in one process draw
+// from later random streams than a fresh process would, so they are
+// independent but not identical to separate runs with the same RngRun.
+static int
+RunBatch (const ScenarioConfig &baseConfig, const FlowOptions &baseOptions, const std::string &batchFile)
+{
+  std::ifstream in (batchFile.c_str ());
+  if (!in)
+    {
+      std::cout << "cannot open batch file " << batchFile << std::endl;
+      return 1;
+    }
+  GlobalDefaults defaults = SaveDefaults ();
+  std::cout << "line,port,goodput_mbps" << std::endl;
+  std::string line;
+  uint32_t lineNumber = 0;
+  while (std::getline (in, line))
+    {
+      ++lineNumber;
+      ScenarioConfig config = baseConfig;
+      FlowOptions options = baseOptions;
+      RestoreDefaults (defaults);
+      CommandLine cmd;
+      AddScenarioOptions (cmd, config, options);
+      if (!ParseOptionLine (line, cmd))
+        {
+          continue;
+        }
+      std::ostringstream tag;
+      tag << "batch" << lineNumber;
+      config.runTag = tag.str ();
+      if (!BuildFlowTable (options, config) || !CheckConfig (config))
+        {
+          std::cout << batchFile << ":" << lineNumber << ": invalid run" << std::endl;
+          return 1;
+        }
+
+      ScenarioResult result = RunScenario (config);
+      for (std::map<uint16_t, uint64_t>::const_iterator rx = result.rxBytes.begin (); rx != result.rxBytes.end (); ++rx)
+        {
+          std::cout << lineNumber << "," << rx->first << "," << Goodput (result, rx->first) << std::endl;
+        }
+    }
+  return 0;
+}
+
+int
+main (int argc, char *argv[])
+{
+  bool verbose = true;
+  uint32_t replications = 1;
+  uint32_t firstRun = 1;
+  uint32_t jobs = 0;
+  std::string summaryFile = "summary.csv";
+  std::string nWifiSweep;
+  std::string batchFile;
+  bool benchmark = false;
+  std::string benchmarkSizes = "5,10,20,50";
+  std::string benchmarkSchedulers;
+  std::string benchmarkFile = "benchmark.csv";
+  std::string baselineFile;
+  double tolerance = 0.1;
+
+  FlowOptions options;
+  options.scenario = 4;
+  options.appRate = "100Mbps";
+  options.saturate = false;
+  options.defaultStart = -1;
+
+  ScenarioConfig config;
+  config.nWifi = 5; //we have 5 wifi nodes
+  config.placement = "auto"; //the original grid while it fits, else a disc
+  config.tracing = true; //to create pcaps
+  config.capture = "all";
+  config.snapLen = 0;
+  config.captureBlock = 1 << 20;
+  config.errorRate = 0.000001;
+  config.simulationTime = 5; //seconds
+  config.linkRate = "5Mbps";
+  config.linkDelay = "2ms";
+  config.throughputInterval = 0.1;
+  config.queueInterval = 0.01;
+  config.reusePayload = true;
+  config.paceBurst = 0;
+  config.protocol = "tcp";
+  config.paceInterval = 0;
+  config.distributed = false;
+  config.preAssociate = false;
+  config.rxCutoff = 0;
+  config.mobilityStep = 0;
+  config.scheduler = "map"; //the ns-3 default
+  config.errorTableStep = 0;
+  config.errorTableValidate = false;
+  config.homes = 1;
+  config.aggregationRate = "1Gbps";
+  config.aggregationDelay = "2ms";
+  config.epochGap = 1;
+  std::string epochFile;
+
+  CommandLine cmd (__FILE__);
+  AddScenarioOptions (cmd, config, options);
+  cmd.AddValue ("verbose", "Tell echo applications to log if true", verbose);
+  cmd.AddValue ("replications", "Number of independent runs (RngRun values) to average", replications);
+  cmd.AddValue ("firstRun", "RngRun of the first replication", firstRun);
+  cmd.AddValue ("jobs", "Replications run at once, 0 for one per core", jobs);
+  cmd.AddValue ("summaryFile", "Per-port mean goodput and 95% CI of the replications", summaryFile);
+  cmd.AddValue ("nWifiSweep", "Comma separated nWifi values to time one after another", nWifiSweep);
+  cmd.AddValue ("epochFile", "Traffic epochs to run, one per line, after the first on the same topology", epochFile);
+  cmd.AddValue ("epochGap", "Seconds without new traffic between epochs, to drain the previous one", config.epochGap);
+  cmd.AddValue ("batchFile", "Run every line of options in this file, one after another", batchFile);
+  cmd.AddValue ("benchmark", "Time scenarios 1-4 at every benchmarkSizes with tracing off and on", benchmark);
+  cmd.AddValue ("benchmarkSizes", "Comma separated nWifi values of the benchmark", benchmarkSizes);
+  cmd.AddValue ("benchmarkSchedulers", "Comma separated schedulers to run every benchmark case with", benchmarkSchedulers);
+  cmd.AddValue ("benchmarkFile", "Where the benchmark writes wall time, events/s and peak RSS per case", benchmarkFile);
+  cmd.AddValue ("baselineFile", "Earlier benchmarkFile to compare against", baselineFile);
+  cmd.AddValue ("mpi", "Run the ISP side on MPI rank 1 and the homes on the other ranks (start with mpirun)", config.distributed);
+  cmd.AddValue ("tolerance", "Allowed slowdown or growth against the baseline, as a fraction", tolerance);
+
+  cmd.Parse (argc,argv);
+
+  if (verbose)
+    {
+      LogComponentEnable ("UdpEchoClientApplication", LOG_LEVEL_INFO);
+      LogComponentEnable ("UdpEchoServerApplication", LOG_LEVEL_INFO);
+    }
+
+  if (config.distributed && (!batchFile.empty () || benchmark || !nWifiSweep.empty ()))
+    {
+      std::cout << "mpi runs a single scenario, not a batch, benchmark or sweep" << std::endl;
+      return 1;
+    }
+  if (!batchFile.empty ())
+    {
+      return RunBatch (config, options, batchFile);
+    }
+  if (benchmark)
+    {
+      return RunBenchmark (config, options, benchmarkSizes, benchmarkSchedulers, benchmarkFile, baselineFile, tolerance);
+    }
+  if (!nWifiSweep.empty ())
+    {
+      return RunScalingSweep (config, options, nWifiSweep);
+    }
+  if (!BuildFlowTable (options, config)
+      || (!epochFile.empty () && !ReadEpochFile (epochFile, options, config))
+      || !CheckConfig (config))
+    {
+      return 1;
+    }
+  if (!config.epochs.empty () && replications > 1)
+    {
+      std::cout << "epochs are summarised per run and cannot be combined with replications" << std::endl;
+      return 1;
+    }
+
+  if (config.distributed)
+    {
+#ifdef NS3_MPI
+      if (replications > 1)
+        {
+          std::cout << "replications fork and cannot be combined with mpi" << std::endl;
+          return 1;
+        }
+      MpiInterface::Enable (&argc, &argv);
+      if (MpiInterface::GetSize () < 2)
+        {
+          std::cout << "mpi needs at least 2 ranks (mpirun -np 2)" << std::endl;
+          MpiInterface::Disable ();
+          return 1;
+        }
+      // both ranks would write the same trace and output files
+      std::ostringstream tag;
+      tag << "rank" << MpiInterface::GetSystemId ();
+      config.runTag = tag.str ();
+      RunScenario (config);
+      MpiInterface::Disable ();
+      return 0;
+#else
+      std::cout << "mpi needs ns-3 configured with --enable-mpi" << std::endl;
+      return 1;
+#endif
+    }
+
+  if (replications > 1)
+    {
+      if (jobs == 0)
+        {
+          long cores = sysconf (_SC_NPROCESSORS_ONLN);
+          jobs = cores > 0 ? cores : 1;
+        }
+      return RunReplications (config, replications, firstRun, jobs, summaryFile);
+    }
+  RunScenario (config);
+  return 0;
+}